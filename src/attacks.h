@@ -18,6 +18,7 @@
 #pragma once
 #include "bitboard.h"
 #include "position.h"
+#include "pext.h"
 #include "magicmoves.hpp"
 
 inline uint64_t generate_pawn_attacks_bb(Square sq, Color side) {
@@ -32,16 +33,33 @@ inline uint64_t generate_king_attacks_bb(Square sq) {
     return KING_ATTACKS_BB[sq];
 }
 
+// Slider attacks come from PEXT tables in BMI2 builds and from magic bitboards otherwise
+inline void init_slider_attacks() {
+#if defined(__BMI2__)
+    init_pext();
+#else
+    init_magics();
+#endif
+}
+
 inline uint64_t generate_bishop_attacks_bb(Square sq, uint64_t occ) {
+#if defined(__BMI2__)
+    return pext_attacks(PEXT_BISHOP[sq], occ);
+#else
     return Bmagic(sq, occ);
+#endif
 }
 
 inline uint64_t generate_rook_attacks_bb(Square sq, uint64_t occ) {
+#if defined(__BMI2__)
+    return pext_attacks(PEXT_ROOK[sq], occ);
+#else
     return Rmagic(sq, occ);
+#endif
 }
 
 inline uint64_t generate_queen_attacks_bb(Square sq, uint64_t occ) {
-    return Qmagic(sq, occ);
+    return generate_bishop_attacks_bb(sq, occ) | generate_rook_attacks_bb(sq, occ);
 }
 
 inline bool square_is_attacked(Position const &position, Square sq, Color enemy, uint64_t occupancy) {
@@ -19,9 +19,13 @@
 #include "search.h"
 #include "position.h"
 #include "stopwatch.h"
+#include "search_threads.h"
 
 #include <iomanip>
 #include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
 
 namespace {
 const std::array<std::string, 50> benchmark_fens{
@@ -71,10 +75,13 @@ void bench() {
     StopWatch watch;
     watch.go();
     auto nodes = 0;
+
+    SEARCH_ABORT = false;
     for (auto const &fen : benchmark_fens) {
         SearchInfo search;
         search.limits.max_depth = 11;
         search.position.set_fen(fen);
+        TT.new_search();
         search_position(search, false);
 
         std::cout << fen << ": " << search.nodes << '\n';
@@ -83,4 +90,183 @@ void bench() {
     watch.stop();
     auto elapsed = watch.elapsed_time().count();
     std::cout << nodes << " nodes " << std::fixed << std::setprecision(0) << std::round(nodes / (elapsed / 1000.0f)) << " nps" << std::endl;
-}
\ No newline at end of file
+}
+
+void eval_check() {
+    uint64_t positions = 0, vector_mismatches = 0, selected_mismatches = 0;
+
+    auto check = [&](Position &position) {
+        auto sums = position.check_output_layer();
+        positions++;
+        vector_mismatches += sums.vector != sums.scalar;
+        selected_mismatches += sums.selected != sums.scalar;
+    };
+
+    // Every bench position and the positions two plies after it
+    for (auto const &fen : benchmark_fens) {
+        Position position;
+        position.set_fen(fen);
+        check(position);
+
+        Movelist movelist;
+        position.generate_legal(movelist);
+        for (auto move : movelist) {
+            position.apply_move(move);
+            check(position);
+
+            Movelist replies;
+            position.generate_legal(replies);
+            for (auto reply : replies) {
+                position.apply_move(reply);
+                check(position);
+                position.revert_move();
+            }
+            position.revert_move();
+        }
+    }
+
+    // The vectorized layer only has to be exact when the int32 decision selected it
+    auto int32  = Network::output_fits_int32();
+    auto passed = selected_mismatches == 0 && (!int32 || vector_mismatches == 0);
+
+    std::cout << "positions: " << positions << "\tint32 output: " << (int32 ? "yes" : "no")
+              << "\tvector mismatches: " << vector_mismatches << "\tselected mismatches: " << selected_mismatches << '\n';
+    std::cout << "evalcheck " << (passed ? "passed" : "failed") << std::endl;
+}
+
+void tt_stress() {
+    constexpr int threads    = 8;
+    constexpr int operations = 400000;
+
+    // 1 MB holds 16384 buckets, far fewer than the keys so threads keep overwriting each other's slots
+    TTable table(1);
+    std::atomic<uint64_t> hits = 0, corrupt = 0;
+
+    auto hammer = [&](int id) {
+        std::mt19937_64 rng(id);
+
+        for (int i = 0; i < operations; i++) {
+            uint64_t hash = (rng() % 200000 + 1) * 0x9E3779B97F4A7C15ull;
+            auto score    = static_cast<int16_t>(hash >> 16);
+            auto seval    = static_cast<int16_t>(hash >> 48);
+            auto move     = static_cast<uint16_t>(hash >> 32);
+            auto depth    = static_cast<uint8_t>((hash >> 40) % 60);
+
+            if (rng() & 1)
+                table.add(TEntry(hash, score, Move(move), depth, TTFLAG_EXACT, seval));
+            else {
+                auto entry = table.retrieve(hash);
+                if (entry.hash == hash) {
+                    hits++;
+                    corrupt += entry.score != score || entry.seval != seval || entry.move != move || entry.depth != depth || entry.flag != TTFLAG_EXACT;
+                }
+            }
+
+            if (id == 0 && i % 1024 == 0)
+                table.hashfull();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(hammer, i);
+    for (auto &worker : workers)
+        worker.join();
+
+    std::cout << "threads: " << threads << "\toperations: " << threads * operations << "\thits: " << hits << "\tcorrupt: " << corrupt << '\n';
+    std::cout << "ttstress " << (hits && !corrupt ? "passed" : "failed") << std::endl;
+}
+
+void prefetch_bench() {
+    constexpr int games = 10000;
+    constexpr int plies = 100;
+
+    uint64_t moves = 0, mismatches = 0;
+
+    // Same games in every pass, only the prefetch differs
+    auto replay = [&](bool prefetch, bool verify) {
+        std::mt19937_64 rng(1);
+        Position position;
+
+        for (int game = 0; game < games; game++) {
+            position.set_fen(benchmark_fens[game % benchmark_fens.size()]);
+
+            for (int ply = 0; ply < plies; ply++) {
+                Movelist movelist;
+                position.generate_legal(movelist);
+                if (movelist.size() == 0)
+                    break;
+
+                auto move  = movelist[rng() % movelist.size()];
+                auto child = position.key_after(move);
+                if (prefetch)
+                    TT.prefetch(child);
+
+                position.apply_move(move);
+                TT.retrieve(position);
+
+                if (verify) {
+                    moves++;
+                    mismatches += child != position.get_key() || child != generate_zobrist_hash(position);
+                }
+            }
+        }
+    };
+
+    auto timed = [&](bool prefetch) {
+        StopWatch watch;
+        watch.go();
+        replay(prefetch, false);
+        watch.stop();
+        return watch.elapsed_time().count();
+    };
+
+    // Best of a few alternating rounds, a single pass is too noisy
+    replay(false, true);
+    auto plain = std::numeric_limits<int64_t>::max(), prefetched = plain;
+    for (int round = 0; round < 3; round++) {
+        plain      = std::min<int64_t>(plain, timed(false));
+        prefetched = std::min<int64_t>(prefetched, timed(true));
+    }
+
+    std::cout << "table: " << TT.get_memory_info() << "\tmoves: " << moves << "\tkey mismatches: " << mismatches << '\n';
+    std::cout << "no prefetch: " << std::fixed << std::setprecision(0) << plain * 1e6 / moves << " ns per move\n";
+    std::cout << "prefetch:    " << prefetched * 1e6 / moves << " ns per move" << std::endl;
+}
+
+void numa_bench(SearchThreadManager &threads, int64_t movetime) {
+    constexpr int positions = 8;
+    constexpr std::pair<ThreadBinding, char const *> bindings[]{
+        { BINDING_NONE, "none" },
+        { BINDING_SPREAD, "spread" },
+        { BINDING_COMPACT, "compact" }
+    };
+
+    auto previous = threads.get_binding();
+    std::cout << "threads " << threads.get_thread_count() << ", " << numa_topology() << '\n';
+
+    for (auto [binding, name] : bindings) {
+        uint64_t nodes = 0;
+        threads.set_binding(binding);
+
+        StopWatch watch;
+        watch.go();
+        for (int i = 0; i < positions; i++) {
+            Position position;
+            SearchLimits limits;
+            position.set_fen(benchmark_fens[i]);
+            limits.stopwatch.go();
+            limits.set_movetime(movetime);
+
+            TT.reset(threads.get_thread_count());
+            threads.begin(position, limits, false);
+            threads.wait();
+            nodes += threads.get_nodes();
+        }
+        watch.stop();
+
+        auto elapsed = std::max<int64_t>(1, watch.elapsed_time().count());
+        std::cout << std::left << std::setw(8) << name << std::right << std::setw(12) << nodes << " nodes " << std::setw(10) << nodes * 1000 / elapsed << " nps" << std::endl;
+    }
+    threads.set_binding(previous);
+}
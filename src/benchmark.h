@@ -19,4 +19,20 @@
 #include "board.h"
 
 void perft(Position &, int depth);
-void bench();
\ No newline at end of file
+void bench();
+
+// Compare the vectorized output layer with the scalar one over the bench positions and their children
+void eval_check();
+
+// Hammer a small table from 8 threads with entries derived from their keys, every hit has to read back intact.
+// Meant to be run from the tsan build
+void tt_stress();
+
+// Replay random games from the bench positions and probe the table for every child, with and without
+// prefetching its bucket from key_after first. Every key_after is also checked against the applied move
+void prefetch_bench();
+
+class SearchThreadManager;
+
+// Search the first bench positions for movetime ms each with every thread binding and report their speed
+void numa_bench(SearchThreadManager &, int64_t movetime);
\ No newline at end of file
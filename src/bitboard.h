@@ -18,6 +18,8 @@
 #pragma once
 #include "board.h"
 
+#include <array>
+
 constexpr uint64_t FILE_A_BB = 0x0101010101010101;
 constexpr uint64_t FILE_B_BB = FILE_A_BB << 1;
 constexpr uint64_t FILE_C_BB = FILE_B_BB << 1;
@@ -182,6 +184,32 @@ constexpr uint64_t CASTLE_OCC_MASK_BB[64]{
     0x000000000000000000, 0x00000000000000000000, 0x00006000000000000000, 0x0000000000000000000
 };
 
+// Squares strictly between two squares (between) or the whole line through them (line),
+// 0 for squares that don't share a rank, file or diagonal
+constexpr std::array<std::array<uint64_t, 64>, 64> compute_alignment_bb(bool line) {
+    constexpr int steps[8][2]{ { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { -1, -1 }, { 1, -1 }, { -1, 1 } };
+    std::array<std::array<uint64_t, 64>, 64> table{};
+
+    for (int sq = 0; sq < 64; sq++) {
+        for (int d = 0; d < 8; d++) {
+            uint64_t full = 1ull << sq;
+            for (int sign : { 1, -1 })
+                for (int f = sq % 8 + sign * steps[d][0], r = sq / 8 + sign * steps[d][1]; f >= 0 && f < 8 && r >= 0 && r < 8; f += sign * steps[d][0], r += sign * steps[d][1])
+                    full |= 1ull << (r * 8 + f);
+
+            uint64_t ray = 0;
+            for (int f = sq % 8 + steps[d][0], r = sq / 8 + steps[d][1]; f >= 0 && f < 8 && r >= 0 && r < 8; f += steps[d][0], r += steps[d][1]) {
+                table[sq][r * 8 + f] = line ? full : ray;
+                ray |= 1ull << (r * 8 + f);
+            }
+        }
+    }
+    return table;
+}
+
+constexpr auto BETWEEN_BB = compute_alignment_bb(false);
+constexpr auto LINE_BB    = compute_alignment_bb(true);
+
 template <Direction dir>
 constexpr uint64_t shift(uint64_t bits) noexcept {
     return dir == DIR_NORTH   ? bits << 8
@@ -68,6 +68,7 @@ void Game::save_game(std::string const &result) {
 }
 
 SearchResult Game::search_position() {
+    search.local_tt.new_search();
     return ::search_position(search, false);
 }
 
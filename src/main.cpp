@@ -23,7 +23,7 @@
 #include "fen-gen/generator.h"
 
 int main(int argc, char **argv) {
-    init_magics();
+    init_slider_attacks();
     init_zobrist_keys();
     init_search_tables();
     Network::init();
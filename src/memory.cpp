@@ -0,0 +1,144 @@
+/*
+  Bit-Genie is an open-source, UCI-compliant chess engine written by
+  Aryan Parekh - https://github.com/Aryan1508/Bit-Genie
+
+  Bit-Genie is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Bit-Genie is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "numa.h"
+#include "memory.h"
+
+#include <new>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+constexpr std::size_t MB = 1024 * 1024;
+constexpr std::size_t GB = 1024 * MB;
+
+std::size_t round_up(std::size_t size, std::size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+#if defined(__linux__)
+using NodeMask = unsigned long[16];
+
+// Mask of the online nodes, returns their count
+int read_numa_nodes(NodeMask mask) {
+    auto count    = 0;
+    auto capacity = int(sizeof(NodeMask) * 8);
+
+    for (auto node : numa_nodes()) {
+        if (node >= capacity)
+            continue;
+
+        mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+        count++;
+    }
+    return count;
+}
+
+// Spread the pages round-robin over every node, has to happen before they are first touched
+int interleave_numa_nodes(void *memory, std::size_t size) {
+    constexpr int INTERLEAVE_POLICY = 3; // MPOL_INTERLEAVE
+
+    NodeMask mask = {};
+    auto nodes    = read_numa_nodes(mask);
+
+    if (nodes <= 1)
+        return 1;
+
+    if (syscall(SYS_mbind, memory, size, INTERLEAVE_POLICY, mask, sizeof(NodeMask) * 8 + 1, 0) != 0)
+        return 1;
+    return nodes;
+}
+
+void *map_huge_pages(std::size_t &size, std::string &pages) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_1GB)
+    if (size >= GB) {
+        auto rounded = round_up(size, GB);
+        auto memory  = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB, -1, 0);
+
+        if (memory != MAP_FAILED) {
+            size  = rounded;
+            pages = "1 GB pages";
+            return memory;
+        }
+    }
+#endif
+
+#if defined(MAP_HUGETLB)
+    auto rounded = round_up(size, 2 * MB);
+    auto huge    = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (huge != MAP_FAILED) {
+        size  = rounded;
+        pages = "2 MB pages";
+        return huge;
+    }
+#endif
+
+    // No reserved huge pages, ask for transparent ones instead
+    size        = round_up(size, 2 * MB);
+    auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory == MAP_FAILED)
+        return nullptr;
+
+#if defined(MADV_HUGEPAGE)
+    pages = madvise(memory, size, MADV_HUGEPAGE) == 0 ? "transparent huge pages" : "4 KB pages";
+#else
+    pages = "4 KB pages";
+#endif
+    return memory;
+}
+#endif
+}
+
+void LargeMemoryDelete::operator()(void *memory) const {
+#if defined(__linux__)
+    if (mapped) {
+        munmap(memory, size);
+        return;
+    }
+#endif
+    ::operator delete[](memory, std::align_val_t(64));
+}
+
+void *allocate_large(std::size_t size, LargeMemoryDelete &deleter, std::string &description) {
+    std::string pages = "default pages";
+    deleter           = LargeMemoryDelete();
+
+#if defined(__linux__)
+    auto mapped_size = size;
+
+    if (auto memory = map_huge_pages(mapped_size, pages)) {
+        auto nodes = interleave_numa_nodes(memory, mapped_size);
+
+        deleter.size   = mapped_size;
+        deleter.mapped = true;
+        description    = std::to_string(mapped_size / MB) + " MB using " + pages;
+
+        if (nodes > 1)
+            description += ", interleaved over " + std::to_string(nodes) + " NUMA nodes";
+        return memory;
+    }
+#endif
+
+    description = std::to_string(size / MB) + " MB using " + pages;
+    return ::operator new[](size, std::align_val_t(64));
+}
@@ -0,0 +1,42 @@
+/*
+  Bit-Genie is an open-source, UCI-compliant chess engine written by
+  Aryan Parekh - https://github.com/Aryan1508/Bit-Genie
+
+  Bit-Genie is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Bit-Genie is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <memory>
+#include <string>
+
+// Releases memory obtained from allocate_large
+struct LargeMemoryDelete {
+    std::size_t size = 0;
+    bool mapped      = false;
+
+    void operator()(void *) const;
+};
+
+template <typename T>
+using LargeMemory = std::unique_ptr<T[], LargeMemoryDelete>;
+
+// At least size bytes aligned to 64, with unspecified contents. Backed by huge pages where the OS allows it,
+// and interleaved over the NUMA nodes on machines with more than one. description says what was obtained
+void *allocate_large(std::size_t size, LargeMemoryDelete &deleter, std::string &description);
+
+template <typename T>
+LargeMemory<T> allocate_large(std::size_t count, std::string &description) {
+    LargeMemoryDelete deleter;
+    auto memory = allocate_large(count * sizeof(T), deleter, description);
+    return LargeMemory<T>(static_cast<T *>(memory), deleter);
+}
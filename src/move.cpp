@@ -30,7 +30,6 @@ void update_castle_rooks(uint64_t &rooks, Move move) {
 
 void Position::revert_move() {
     history_ply--;
-    network.revert_hidden_updates();
 
     auto move     = history[history_ply].move;
     auto captured = history[history_ply].captured;
@@ -69,6 +68,9 @@ void Position::revert_move() {
         move_piece(to, from);
         add_piece(static_cast<Square>(to ^ 8), captured);
     }
+
+    if (!network.revert_hidden_updates())
+        network.recalculate_hidden_layer(to_net_input());
 }
 
 void Position::apply_move(Move move) {
@@ -85,21 +87,17 @@ void Position::apply_move(Move move) {
     auto flag      = move.flag();
     auto moving    = get_piece(from);
     auto captured  = get_piece(to);
-    auto old_rooks = castle_rooks;
 
+    // key_after is the only place that hashes a move, so prefetched child keys always match
+    hash  = key_after(move);
+    ep_sq = SQ_NULL;
     halfmoves++;
 
-    if (ep_sq != SQ_NULL) {
-        zobrist_hash_ep(hash, ep_sq);
-        ep_sq = SQ_NULL;
-    }
-
     update_castle_rooks(castle_rooks, move);
-    zobrist_hash_castle(hash, old_rooks ^ castle_rooks);
 
     if (flag == MVEFLAG_NORMAL) {
         if (captured != PCE_NULL) {
-            hist_captured = remove_piece_hash(to);
+            hist_captured = remove_piece(to);
             halfmoves     = 0;
             updates.push_back(InputUpdate(to, hist_captured, InputUpdate::Removal));
         }
@@ -107,7 +105,7 @@ void Position::apply_move(Move move) {
         updates.push_back(InputUpdate(from, moving, InputUpdate::Removal));
         updates.push_back(InputUpdate(to, moving, InputUpdate::Addition));
 
-        move_piece_hash(from, to);
+        move_piece(from, to);
 
         if (moving == PCE_WPAWN || moving == PCE_BPAWN) {
             halfmoves = 0;
@@ -115,10 +113,8 @@ void Position::apply_move(Move move) {
                 auto enemy_pawns = get_bb(PT_PAWN, !get_side());
                 auto ep_slots    = generate_pawn_attacks_bb(static_cast<Square>(to ^ 8), get_side());
 
-                if (enemy_pawns & ep_slots) {
+                if (enemy_pawns & ep_slots)
                     ep_sq = static_cast<Square>(to ^ 8);
-                    zobrist_hash_ep(hash, ep_sq);
-                }
             }
         }
     }
@@ -127,13 +123,13 @@ void Position::apply_move(Move move) {
         halfmoves = 0;
 
         if (captured != PCE_NULL) {
-            hist_captured = remove_piece_hash(to);
+            hist_captured = remove_piece(to);
             updates.push_back(InputUpdate(to, hist_captured, InputUpdate::Removal));
         }
 
         auto promoted = make_piece(move.promoted(), get_side());
-        remove_piece_hash(from);
-        add_piece_hash(to, promoted);
+        remove_piece(from);
+        add_piece(to, promoted);
 
         updates.push_back(InputUpdate(from, moving, InputUpdate::Removal));
         updates.push_back(InputUpdate(to, promoted, InputUpdate::Addition));
@@ -156,25 +152,86 @@ void Position::apply_move(Move move) {
         }
 
         auto king = moving, rook = get_piece(rook_from);
-        move_piece_hash(from, to);
-        move_piece_hash(rook_from, rook_to);
+        move_piece(from, to);
+        move_piece(rook_from, rook_to);
         updates.push_back(InputUpdate(from, king, InputUpdate::Removal));
         updates.push_back(InputUpdate(to, king, InputUpdate::Addition));
         updates.push_back(InputUpdate(rook_from, rook, InputUpdate::Removal));
         updates.push_back(InputUpdate(rook_to, rook, InputUpdate::Addition));
     } else {
         halfmoves = 0;
-        move_piece_hash(from, to);
+        move_piece(from, to);
         auto cap_sq   = static_cast<Square>(to ^ 8);
-        hist_captured = remove_piece_hash(cap_sq);
+        hist_captured = remove_piece(cap_sq);
         updates.push_back(InputUpdate(from, moving, InputUpdate::Removal));
         updates.push_back(InputUpdate(to, moving, InputUpdate::Addition));
         updates.push_back(InputUpdate(cap_sq, hist_captured, InputUpdate::Removal));
     }
 
     side = !side;
-    zobrist_hash_side(hash);
-    network.update_hidden_layer(updates);
+    if (!network.update_hidden_layer(updates, get_lsb(get_bb(PT_KING, CLR_WHITE)), get_lsb(get_bb(PT_KING, CLR_BLACK))))
+        network.refresh_king_buckets(to_net_input());
+}
+
+uint64_t Position::key_after(Move move) const {
+    auto key      = hash;
+    auto from     = move.from();
+    auto to       = move.to();
+    auto flag     = move.flag();
+    auto moving   = get_piece(from);
+    auto captured = get_piece(to);
+    auto rooks    = castle_rooks;
+
+    if (ep_sq != SQ_NULL)
+        zobrist_hash_ep(key, ep_sq);
+
+    update_castle_rooks(rooks, move);
+    zobrist_hash_castle(key, rooks ^ castle_rooks);
+    zobrist_hash_side(key);
+
+    if (flag == MVEFLAG_NORMAL) {
+        if (captured != PCE_NULL)
+            zobrist_hash_piece(key, captured, to);
+
+        zobrist_hash_piece(key, moving, from);
+        zobrist_hash_piece(key, moving, to);
+
+        if ((moving == PCE_WPAWN || moving == PCE_BPAWN) && (to ^ from) == 16) {
+            auto enemy_pawns = get_bb(PT_PAWN, !side);
+            auto ep_slots    = generate_pawn_attacks_bb(static_cast<Square>(to ^ 8), side);
+
+            if (enemy_pawns & ep_slots)
+                zobrist_hash_ep(key, static_cast<Square>(to ^ 8));
+        }
+    }
+
+    else if (flag == MVEFLAG_PROMOTION) {
+        if (captured != PCE_NULL)
+            zobrist_hash_piece(key, captured, to);
+
+        zobrist_hash_piece(key, moving, from);
+        zobrist_hash_piece(key, make_piece(move.promoted(), side), to);
+    }
+
+    else if (flag == MVEFLAG_CASTLE) {
+        auto rook_from = to == SQ_C1 ? SQ_A1 : to == SQ_G1 ? SQ_H1
+                                           : to == SQ_C8   ? SQ_A8
+                                                           : SQ_H8;
+        auto rook_to   = to == SQ_C1 ? SQ_D1 : to == SQ_G1 ? SQ_F1
+                                           : to == SQ_C8   ? SQ_D8
+                                                           : SQ_F8;
+        auto rook      = get_piece(rook_from);
+
+        zobrist_hash_piece(key, moving, from);
+        zobrist_hash_piece(key, moving, to);
+        zobrist_hash_piece(key, rook, rook_from);
+        zobrist_hash_piece(key, rook, rook_to);
+    } else {
+        zobrist_hash_piece(key, moving, from);
+        zobrist_hash_piece(key, moving, to);
+        zobrist_hash_piece(key, make_piece(PT_PAWN, !side), static_cast<Square>(to ^ 8));
+    }
+    return key;
 }
 
 void Position::apply_nullmove() {
@@ -38,68 +38,120 @@ constexpr uint64_t get_promotion_rank_bb(Color side) {
     return side == CLR_WHITE ? RANK_8_BB : RANK_1_BB;
 }
 
-void verified_add(Movelist &movelist, Position const &position, Move move) {
-    if (position.is_legal(move))
-        movelist.push_back(move);
+// Pins and checks against the side to move, found once per generate call so moves are legal as they are emitted
+struct LegalMasks {
+    Square king;
+    uint64_t checkers;
+    uint64_t pinned;
+    uint64_t evasions; // squares that block or capture a single checker, every square when not in check
+};
+
+LegalMasks compute_legal_masks(Position const &position) {
+    auto side    = position.get_side();
+    auto king    = get_lsb(position.get_bb(PT_KING, side));
+    auto enemy   = position.get_bb(!side);
+    auto queens  = position.get_bb(PT_QUEEN);
+    auto rooks   = generate_rook_attacks_bb(king, 0) & (position.get_bb(PT_ROOK) | queens);
+    auto bishops = generate_bishop_attacks_bb(king, 0) & (position.get_bb(PT_BISHOP) | queens);
+    auto snipers = (rooks | bishops) & enemy;
+
+    LegalMasks masks{ king, generate_sq_attackers_bb(position, king) & enemy, 0, ~0ull };
+
+    while (snipers) {
+        auto blockers = BETWEEN_BB[king][pop_lsb(snipers)] & position.get_bb();
+        if (blockers && !is_several(blockers))
+            masks.pinned |= blockers & position.get_bb(side);
+    }
+
+    if (masks.checkers)
+        masks.evasions = BETWEEN_BB[king][get_lsb(masks.checkers)] | masks.checkers;
+    return masks;
 }
 
-void serialize_bitboard(Movelist &movelist, Position const &position, uint64_t bb, Square from) {
-    while (bb)
-        verified_add(movelist, position, Move(from, pop_lsb(bb)));
+// A pinned piece may only move along the line through its king
+bool breaks_pin(LegalMasks const &masks, Square from, Square to) {
+    return test_bit(masks.pinned, from) && !test_bit(LINE_BB[masks.king][from], to);
 }
 
 template <MoveFlag flag = MVEFLAG_NORMAL>
-void serialize_bitboard(Movelist &movelist, Position const &position, uint64_t bb, int moved) {
+void serialize_bitboard(Movelist &movelist, LegalMasks const &masks, uint64_t bb, int moved) {
+    bb &= masks.evasions;
+
     while (bb) {
         auto to   = pop_lsb(bb);
         auto from = static_cast<Square>(to - moved);
 
+        if (breaks_pin(masks, from, to))
+            continue;
+
         if (flag == MVEFLAG_PROMOTION) {
-            verified_add(movelist, position, Move(from, to, PT_KNIGHT));
-            verified_add(movelist, position, Move(from, to, PT_BISHOP));
-            verified_add(movelist, position, Move(from, to, PT_ROOK));
-            verified_add(movelist, position, Move(from, to, PT_QUEEN));
+            movelist.push_back(Move(from, to, PT_KNIGHT));
+            movelist.push_back(Move(from, to, PT_BISHOP));
+            movelist.push_back(Move(from, to, PT_ROOK));
+            movelist.push_back(Move(from, to, PT_QUEEN));
 
         } else
-            verified_add(movelist, position, Move(from, to, flag));
+            movelist.push_back(Move(from, to, flag));
     }
 }
+
+// The king is the only piece whose destinations are checked one by one, with itself removed from the board
+template <Color side>
+void generate_king_moves(Position const &position, LegalMasks const &masks, Movelist &movelist, uint64_t targets) {
+    auto occupancy = position.get_bb() ^ (1ull << masks.king);
+    auto moves     = generate_king_attacks_bb(masks.king) & targets;
+
+    while (moves) {
+        auto to = pop_lsb(moves);
+        if (!square_is_attacked(position, to, !side, occupancy))
+            movelist.push_back(Move(masks.king, to));
+    }
+}
+
 template <PieceType pt, Color side>
-void generate_simple_moves(Position const &position, Movelist &movelist, uint64_t targets) {
+void generate_simple_moves(Position const &position, LegalMasks const &masks, Movelist &movelist, uint64_t targets) {
     auto pieces = position.get_bb(pt, side);
 
+    // A pinned piece can neither capture the checker nor block its ray
+    if (masks.checkers)
+        pieces &= ~masks.pinned;
+
     while (pieces) {
         auto from  = pop_lsb(pieces);
-        auto moves = generate_attacks_bb(pt, from, position.get_bb()) & targets;
-        serialize_bitboard(movelist, position, moves, from);
+        auto moves = generate_attacks_bb(pt, from, position.get_bb()) & targets & masks.evasions;
+
+        if (test_bit(masks.pinned, from))
+            moves &= LINE_BB[masks.king][from];
+
+        while (moves)
+            movelist.push_back(Move(from, pop_lsb(moves)));
     }
 }
 
 template <Color side>
-void generate_simple_moves(Position const &position, Movelist &movelist, uint64_t targets) {
-    generate_simple_moves<PT_KING, side>(position, movelist, targets);
-    generate_simple_moves<PT_KNIGHT, side>(position, movelist, targets);
-    generate_simple_moves<PT_BISHOP, side>(position, movelist, targets);
-    generate_simple_moves<PT_ROOK, side>(position, movelist, targets);
-    generate_simple_moves<PT_QUEEN, side>(position, movelist, targets);
+void generate_simple_moves(Position const &position, LegalMasks const &masks, Movelist &movelist, uint64_t targets) {
+    generate_simple_moves<PT_KNIGHT, side>(position, masks, movelist, targets);
+    generate_simple_moves<PT_BISHOP, side>(position, masks, movelist, targets);
+    generate_simple_moves<PT_ROOK, side>(position, masks, movelist, targets);
+    generate_simple_moves<PT_QUEEN, side>(position, masks, movelist, targets);
 }
 
 template <Color side>
-void generate_pawn_captures(Position const &position, Movelist &movelist, uint64_t forwarded_pawns) {
+void generate_pawn_captures(Position const &position, LegalMasks const &masks, Movelist &movelist, uint64_t forwarded_pawns) {
     constexpr uint64_t promo_bb = get_promotion_rank_bb(side);
 
     auto captures_l = position.get_bb(!position.get_side()) & shift<DIR_WEST>(forwarded_pawns);
     auto captures_r = position.get_bb(!position.get_side()) & shift<DIR_EAST>(forwarded_pawns);
 
-    serialize_bitboard(movelist, position, captures_l & ~promo_bb, compute_relative_forward(side) + DIR_WEST);
-    serialize_bitboard(movelist, position, captures_r & ~promo_bb, compute_relative_forward(side) + DIR_EAST);
+    serialize_bitboard(movelist, masks, captures_l & ~promo_bb, compute_relative_forward(side) + DIR_WEST);
+    serialize_bitboard(movelist, masks, captures_r & ~promo_bb, compute_relative_forward(side) + DIR_EAST);
 
-    serialize_bitboard<MVEFLAG_PROMOTION>(movelist, position, captures_l & promo_bb, compute_relative_forward(side) + DIR_WEST);
-    serialize_bitboard<MVEFLAG_PROMOTION>(movelist, position, captures_r & promo_bb, compute_relative_forward(side) + DIR_EAST);
+    serialize_bitboard<MVEFLAG_PROMOTION>(movelist, masks, captures_l & promo_bb, compute_relative_forward(side) + DIR_WEST);
+    serialize_bitboard<MVEFLAG_PROMOTION>(movelist, masks, captures_r & promo_bb, compute_relative_forward(side) + DIR_EAST);
 }
 
 template <Color side>
-void generate_pawn_pushes(Position const &position, Movelist &movelist, uint64_t forwarded_pawns) {
+void generate_pawn_pushes(Position const &position, LegalMasks const &masks, Movelist &movelist, uint64_t forwarded_pawns) {
     constexpr uint64_t promo_bb   = get_promotion_rank_bb(side);
     constexpr uint64_t push_2r_bb = side == CLR_WHITE ? RANK_4_BB : RANK_5_BB;
 
@@ -107,25 +159,36 @@ void generate_pawn_pushes(Position const &position, Movelist &movelist, uint64_t
     auto push_1 = forwarded_pawns & empty;
     auto push_2 = shift<compute_relative_forward(side)>(push_1) & push_2r_bb & empty;
 
-    serialize_bitboard(movelist, position, push_1 & ~promo_bb, compute_relative_forward(side));
-    serialize_bitboard(movelist, position, push_2, compute_relative_forward(side) + compute_relative_forward(side));
+    serialize_bitboard(movelist, masks, push_1 & ~promo_bb, compute_relative_forward(side));
+    serialize_bitboard(movelist, masks, push_2, compute_relative_forward(side) + compute_relative_forward(side));
 
-    serialize_bitboard<MVEFLAG_PROMOTION>(movelist, position, push_1 & promo_bb, compute_relative_forward(side));
+    serialize_bitboard<MVEFLAG_PROMOTION>(movelist, masks, push_1 & promo_bb, compute_relative_forward(side));
 }
 
+// En passant removes two pieces from the capturer's rank at once, it is the one move still verified in full
 template <Color side>
 void generate_enpassant(Position const &position, Movelist &movelist, uint64_t forwarded_pawns) {
     if (position.get_ep() == SQ_NULL)
         return;
 
-    auto ep_bb = 1ull << position.get_ep();
-    auto ep_l  = ep_bb & shift<DIR_WEST>(forwarded_pawns);
-    auto ep_r  = ep_bb & shift<DIR_EAST>(forwarded_pawns);
+    auto to   = position.get_ep();
+    auto ep_l = (1ull << to) & shift<DIR_WEST>(forwarded_pawns);
+    auto ep_r = (1ull << to) & shift<DIR_EAST>(forwarded_pawns);
 
-    serialize_bitboard<MVEFLAG_ENPASSANT>(movelist, position, ep_l, compute_relative_forward(side) + DIR_WEST);
-    serialize_bitboard<MVEFLAG_ENPASSANT>(movelist, position, ep_r, compute_relative_forward(side) + DIR_EAST);
+    if (ep_l) {
+        auto move = Move(static_cast<Square>(to - compute_relative_forward(side) - DIR_WEST), to, MVEFLAG_ENPASSANT);
+        if (position.is_legal(move))
+            movelist.push_back(move);
+    }
+
+    if (ep_r) {
+        auto move = Move(static_cast<Square>(to - compute_relative_forward(side) - DIR_EAST), to, MVEFLAG_ENPASSANT);
+        if (position.is_legal(move))
+            movelist.push_back(move);
+    }
 }
 
+// att_cond holds the king's path including its destination
 void generate_castle(Position const &position, Movelist &movelist, Square from, Square to, uint64_t occ_cond, uint64_t att_cond) {
     if (!test_bit(position.get_castle_bits(), to))
         return;
@@ -137,45 +200,68 @@ void generate_castle(Position const &position, Movelist &movelist, Square from,
         if (square_is_attacked(position, pop_lsb(att_cond), !position.get_side()))
             return;
 
-    verified_add(movelist, position, Move(from, to, MVEFLAG_CASTLE));
+    movelist.push_back(Move(from, to, MVEFLAG_CASTLE));
 }
 
 template <Color side>
 void generate_castle(Position const &position, Movelist &movelist) {
     if (side == CLR_WHITE) {
-        generate_castle(position, movelist, SQ_E1, SQ_C1, 0x0E, 0x08);
-        generate_castle(position, movelist, SQ_E1, SQ_G1, 0x60, 0x20);
+        generate_castle(position, movelist, SQ_E1, SQ_C1, 0x0E, 0x0C);
+        generate_castle(position, movelist, SQ_E1, SQ_G1, 0x60, 0x60);
     } else {
-        generate_castle(position, movelist, SQ_E8, SQ_C8, 0xE00000000000000, 0x800000000000000);
-        generate_castle(position, movelist, SQ_E8, SQ_G8, 0x6000000000000000, 0x2000000000000000);
+        generate_castle(position, movelist, SQ_E8, SQ_C8, 0xE00000000000000, 0xC00000000000000);
+        generate_castle(position, movelist, SQ_E8, SQ_G8, 0x6000000000000000, 0x6000000000000000);
     }
 }
 
 template <MoveGenType type, Color side>
-void generate_pawn_moves(Position const &position, Movelist &movelist) {
+void generate_pawn_moves(Position const &position, LegalMasks const &masks, Movelist &movelist) {
     constexpr auto forward = compute_relative_forward(side);
     auto pawns             = position.get_bb(PT_PAWN, side);
     auto forwarded_pawns   = shift<forward>(pawns);
 
     if (type == MoveGenType::MOVEGEN_ALL) {
-        generate_pawn_pushes<side>(position, movelist, forwarded_pawns);
-        generate_pawn_captures<side>(position, movelist, forwarded_pawns);
+        generate_pawn_pushes<side>(position, masks, movelist, forwarded_pawns);
+        generate_pawn_captures<side>(position, masks, movelist, forwarded_pawns);
         generate_enpassant<side>(position, movelist, forwarded_pawns);
     } else if (type == MoveGenType::MOVEGEN_NOISY) {
-        generate_pawn_captures<side>(position, movelist, forwarded_pawns);
+        generate_pawn_captures<side>(position, masks, movelist, forwarded_pawns);
         generate_enpassant<side>(position, movelist, forwarded_pawns);
     } else
-        generate_pawn_pushes<side>(position, movelist, forwarded_pawns);
+        generate_pawn_pushes<side>(position, masks, movelist, forwarded_pawns);
+}
+
+// Every answer to a check: king moves, and for a single check the captures of the checker and
+// the interpositions on its ray
+template <Color side>
+void generate_evasions(Position const &position, LegalMasks const &masks, Movelist &movelist) {
+    generate_king_moves<side>(position, masks, movelist, ~position.get_bb(side));
+
+    if (is_several(masks.checkers))
+        return;
+
+    generate_simple_moves<side>(position, masks, movelist, masks.evasions);
+    generate_pawn_moves<MoveGenType::MOVEGEN_ALL, side>(position, masks, movelist);
 }
 
 template <MoveGenType type, Color side>
 void generate_moves(Position const &position, Movelist &movelist) {
     auto targets = get_targets<type>(position);
+    auto masks   = compute_legal_masks(position);
+
+    if (type == MoveGenType::MOVEGEN_ALL && masks.checkers)
+        return generate_evasions<side>(position, masks, movelist);
 
-    generate_simple_moves<side>(position, movelist, targets);
-    generate_pawn_moves<type, side>(position, movelist);
+    generate_king_moves<side>(position, masks, movelist, targets);
+
+    // Only the king can answer a double check
+    if (is_several(masks.checkers))
+        return;
 
-    if (type != MoveGenType::MOVEGEN_NOISY && !position.king_in_check())
+    generate_simple_moves<side>(position, masks, movelist, targets);
+    generate_pawn_moves<type, side>(position, masks, movelist);
+
+    if (type != MoveGenType::MOVEGEN_NOISY && !masks.checkers)
         generate_castle<side>(position, movelist);
 }
 
@@ -190,6 +276,12 @@ void Position::generate_legal(Movelist &movelist) const {
     ::generate_moves<MoveGenType::MOVEGEN_ALL>(*this, movelist);
 }
 
+void Position::generate_evasions(Movelist &movelist) const {
+    auto masks = compute_legal_masks(*this);
+    side == CLR_WHITE ? ::generate_evasions<CLR_WHITE>(*this, masks, movelist)
+                      : ::generate_evasions<CLR_BLACK>(*this, masks, movelist);
+}
+
 void Position::generate_noisy(Movelist &movelist) const {
     ::generate_moves<MoveGenType::MOVEGEN_NOISY>(*this, movelist);
 }
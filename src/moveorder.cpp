@@ -107,14 +107,36 @@ void score_movelist(Movelist &movelist, SearchInfo &search) {
     }
 }
 
+// Captures keep the exchange value scale of score_movelist, SEE pruning in the search relies on it.
+// The picker orders them ahead of king moves and blocks, which are scored by history
+bool is_capture_evasion(Position const &position, Move move) {
+    return move_is_capture(position, move) || move.flag() == MVEFLAG_ENPASSANT;
+}
+
+void score_evasions(Movelist &movelist, SearchInfo &search) {
+    auto &position = search.position;
+    for (auto &move : movelist) {
+        if (is_capture_evasion(position, move)) {
+            move.score = see(position, move) + get_history(search.capture_history, position, move) / 128;
+        } else {
+            int score = get_history(search.history, position, move);
+
+            if (position.previous_move() != MOVE_NULL)
+                score += get_history(search.counter_history, position, move);
+
+            move.score = std::clamp(score, -32767, 32767) / 4;
+        }
+    }
+}
+
 void bubble_top_move(Movelist::iterator begin, Movelist::iterator end) {
     auto best = std::max_element(begin, end);
     std::iter_swap(best, begin);
 }
 }
 
-MovePicker::MovePicker(SearchInfo &s)
-    : search(&s) {
+MovePicker::MovePicker(SearchInfo &s, Move tt)
+    : search(&s), tt_move(tt) {
     stage = STAGE_HASH_MOVE;
 }
 
@@ -150,12 +172,10 @@ bool MovePicker::next(Move &move) {
     };
 
     if (stage == STAGE_HASH_MOVE) {
-        stage       = STAGE_GEN_NOISY;
-        auto &entry = retrieve_tt_entry(*search);
-        auto hmove  = Move(entry.move);
+        stage = position.king_in_check() ? STAGE_GEN_EVASIONS : STAGE_GEN_NOISY;
 
-        if (entry.hash == position.get_key() && can_move(hmove)) {
-            move      = hmove;
+        if (tt_move != MOVE_NULL && can_move(tt_move)) {
+            move      = tt_move;
             hash_move = move;
             return true;
         }
@@ -240,5 +260,27 @@ bool MovePicker::next(Move &move) {
             return true;
         }
     }
+
+    // In check every legal move is generated at once, killers are unlikely to answer the check
+    if (stage == STAGE_GEN_EVASIONS) {
+        position.generate_evasions(movelist);
+
+        score_evasions(movelist, *search);
+        current        = movelist.begin();
+        quiet_evasions = std::partition(movelist.begin(), movelist.end(), [&](Move move) { return is_capture_evasion(position, move); });
+        stage          = STAGE_EVASIONS;
+    }
+
+    if (stage == STAGE_EVASIONS) {
+        bubble_top_move(current, current < quiet_evasions ? quiet_evasions : movelist.end());
+        if (current != movelist.end()) {
+            move = *current++;
+
+            if (move == hash_move)
+                return next(move);
+
+            return true;
+        }
+    }
     return false;
 }
\ No newline at end of file
@@ -27,12 +27,15 @@ enum MovePickStage : uint8_t {
     STAGE_KILLER_2,
     STAGE_BAD_NOISY,
     STAGE_GEN_QUIET,
-    STAGE_QUIET
+    STAGE_QUIET,
+    STAGE_GEN_EVASIONS,
+    STAGE_EVASIONS
 };
 
 class MovePicker {
 public:
-    MovePicker(SearchInfo &);
+    // tt_move is the move of the hash entry the search already probed, MOVE_NULL on a miss
+    MovePicker(SearchInfo &, Move tt_move = MOVE_NULL);
 
     bool next(Move &);
     bool qnext(Move &);
@@ -45,5 +48,7 @@ public:
     Move killer2        = MOVE_NULL;
 private:
     SearchInfo *search;
+    Move tt_move;
     Movelist::iterator current;
+    Movelist::iterator quiet_evasions; // evasions are partitioned, captures come before this
 };
\ No newline at end of file
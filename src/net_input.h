@@ -19,25 +19,55 @@
 #include "board.h"
 #include "fixed_list.h"
 
-#include <vector>
+// Buckets of the king-bucketed feature set, indexed by the king square from its own side's view
+constexpr int KING_BUCKETS = 4;
+
+// clang-format off
+constexpr uint8_t KING_BUCKET_MAP[64]{
+    0, 0, 0, 0, 1, 1, 1, 1,
+    0, 0, 0, 0, 1, 1, 1, 1,
+    2, 2, 2, 2, 3, 3, 3, 3,
+    2, 2, 2, 2, 3, 3, 3, 3,
+    2, 2, 2, 2, 3, 3, 3, 3,
+    2, 2, 2, 2, 3, 3, 3, 3,
+    2, 2, 2, 2, 3, 3, 3, 3,
+    2, 2, 2, 2, 3, 3, 3, 3,
+};
+// clang-format on
+
+inline int calculate_king_bucket(Square king, Color perspective) {
+    return KING_BUCKET_MAP[perspective == CLR_WHITE ? king : flip_square(king)];
+}
 
 inline uint16_t calculate_input_index(Square sq, Piece piece) {
     return piece * 64 + sq;
 }
 
+// Index of a piece seen from one side: the board is flipped for black so that its own pieces come first
+inline uint16_t calculate_input_index(Square sq, Piece piece, Color perspective, int bucket) {
+    if (perspective == CLR_BLACK) {
+        sq    = flip_square(sq);
+        piece = make_piece(compute_piece_type(piece), !compute_color(piece));
+    }
+    return bucket * 768 + calculate_input_index(sq, piece);
+}
+
 struct InputUpdate {
     enum : int8_t { Addition = 1,
                     Removal  = -1 };
 
-    uint16_t index;
+    Square sq;
+    Piece piece;
     int8_t coeff;
 
     InputUpdate() = default;
 
     InputUpdate(Square sq, Piece piece, int8_t coeff)
-        : index(calculate_input_index(sq, piece)), coeff(coeff) {
+        : sq(sq), piece(piece), coeff(coeff) {
     }
 };
 
 using NetworkUpdateList = FixedList<InputUpdate, 4>;
-using NetworkInput      = std::vector<uint16_t>;
\ No newline at end of file
+
+// Bitboards of every piece, the network refreshes from the difference to the last board it saw
+using NetworkInput = std::array<uint64_t, PCE_TOTAL>;
\ No newline at end of file
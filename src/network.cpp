@@ -15,76 +15,516 @@
   You should have received a copy of the GNU General Public License
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include "simd.h"
 #include "network.h"
+#include "bitboard.h"
 #include "incbin/incbin.h"
 
 #include <math.h>
-#include <vector>
+#include <memory>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 INCBIN(Network, EVALFILE);
-constexpr int16_t Q_PRECISION = 64;
 
-int16_t quantize(float x) {
-    return round(x * Q_PRECISION);
+namespace {
+using FeatureList = FixedList<uint16_t, 64>;
+
+// Write input + weights of the added inputs - weights of the removed ones into output, keeping one
+// tile in registers at a time so every change is fused into a single pass over the accumulator
+template <int H>
+void apply_changes(int16_t const *input, int16_t *output, int16_t const *weights, FeatureList const &added, FeatureList const &removed) {
+    constexpr int registers = std::min(VEC_REGISTERS, H / VEC_LANES);
+    constexpr int tile_size = registers * VEC_LANES;
+
+    for (int tile = 0; tile < H; tile += tile_size) {
+        vec_t regs[registers];
+
+        for (int i = 0; i < registers; i++)
+            regs[i] = vec_load(input + tile + i * VEC_LANES);
+
+        for (auto index : added) {
+            auto row = weights + index * H + tile;
+
+            for (int i = 0; i < registers; i++)
+                regs[i] = vec_add(regs[i], vec_load(row + i * VEC_LANES));
+        }
+
+        for (auto index : removed) {
+            auto row = weights + index * H + tile;
+
+            for (int i = 0; i < registers; i++)
+                regs[i] = vec_sub(regs[i], vec_load(row + i * VEC_LANES));
+        }
+
+        for (int i = 0; i < registers; i++)
+            vec_store(output + tile + i * VEC_LANES, regs[i]);
+    }
+}
+
+template <int H>
+int64_t output_dot_scalar(int16_t const *neurons, int16_t const *weights) {
+    int64_t sum = 0;
+
+    for (int k = 0; k < H; k++)
+        sum += std::max<int64_t>(neurons[k], 0) * weights[k];
+    return sum;
+}
+
+// Clipped-ReLU dot product accumulated on int32 lanes, each lane only sums the products vec_madd routes to it
+template <int H>
+int64_t output_dot(int16_t const *neurons, int16_t const *weights) {
+    auto zero = vec_zero();
+    auto sum  = vec_zero32();
+
+    for (int k = 0; k < H; k += VEC_LANES) {
+        auto relu = vec_max(vec_load(neurons + k), zero);
+        sum       = vec_add32(sum, vec_madd(relu, vec_load(weights + k)));
+    }
+
+    int32_t lanes[VEC_LANES32];
+    vec_store32(lanes, sum);
+
+    int64_t total = 0;
+    for (auto lane : lanes)
+        total += lane;
+    return total;
+}
+
+// A clipped neuron is at most INT16_MAX, so a lane can never exceed the sum of INT16_MAX * |weight| routed to it
+bool output_lanes_fit_int32(int16_t const *weights, int size) {
+    int64_t bounds[VEC_LANES32] = {};
+
+    for (int k = 0; k < size; k++)
+        bounds[(k % VEC_LANES) / 2] += int64_t(INT16_MAX) * std::abs(weights[k]);
+
+    return std::all_of(std::begin(bounds), std::end(bounds), [](int64_t bound) { return bound <= INT32_MAX; });
+}
+
+struct Kernels {
+    void (*apply_changes)(int16_t const *, int16_t *, int16_t const *, FeatureList const &, FeatureList const &) = nullptr;
+    int64_t (*output_dot)(int16_t const *, int16_t const *) = nullptr;
+
+    // Both output paths regardless of the selection, only used by evalcheck
+    int64_t (*output_dot_vector)(int16_t const *, int16_t const *) = nullptr;
+    int64_t (*output_dot_scalar)(int16_t const *, int16_t const *) = nullptr;
+};
+
+template <int H>
+Kernels make_kernels(bool int32_output_is_safe) {
+    static_assert(H <= Network::MAX_HIDDEN_SIZE && H % VEC_LANES == 0);
+    return { &apply_changes<H>, int32_output_is_safe ? &output_dot<H> : &output_dot_scalar<H>, &output_dot<H>, &output_dot_scalar<H> };
+}
+
+// Inference is only compiled for these hidden layer sizes
+bool select_kernels(Kernels &kernels, int hidden_size, bool int32_output_is_safe) {
+    switch (hidden_size) {
+    case 128:
+        kernels = make_kernels<128>(int32_output_is_safe);
+        return true;
+    case 256:
+        kernels = make_kernels<256>(int32_output_is_safe);
+        return true;
+    case 512:
+        kernels = make_kernels<512>(int32_output_is_safe);
+        return true;
+    default:
+        return false;
+    }
+}
+
+struct AlignedDelete {
+    void operator()(int16_t *p) const {
+        ::operator delete[](p, std::align_val_t(64));
+    }
+};
+
+using AlignedBuffer = std::unique_ptr<int16_t[], AlignedDelete>;
+
+AlignedBuffer make_aligned_buffer(std::size_t size) {
+    return AlignedBuffer(new (std::align_val_t(64)) int16_t[size]);
+}
+
+struct LoadedNetwork {
+    NetworkHeader header;
+    AlignedBuffer storage;
+    std::shared_ptr<char const> mapping; // pre-quantized file the parameters point into
+    int16_t const *hidden_weights = nullptr;
+    int16_t const *hidden_biases  = nullptr;
+    int16_t const *output_weights = nullptr;
+    int32_t output_bias           = 0;
+    Kernels kernels;
+};
+
+LoadedNetwork net;
+
+// Bumped on every load so cached accumulators of the previous network are never reused
+std::uint32_t net_generation = 0;
+
+int16_t quantize(float x, uint32_t scale) {
+    return round(x * scale);
+}
+
+int perspectives(NetworkHeader const &header) {
+    return header.feature_set == FEATURES_KING_BUCKETS ? 2 : 1;
+}
+
+bool header_is_supported(NetworkHeader const &header) {
+    auto inputs = header.feature_set == FEATURES_PSQ ? 768u : header.feature_set == FEATURES_KING_BUCKETS ? 768u * KING_BUCKETS
+                                                                                                           : 0u;
+    return header.version == 1 && inputs && header.input_size == inputs && header.output_size == 1 && (header.weight_type == WEIGHTS_FLOAT32 || header.weight_type == WEIGHTS_INT16) && header.hidden_scale && header.output_scale;
+}
+
+// The int32 output path has to be safe for the weights of every perspective
+bool output_is_int32_safe(LoadedNetwork const &loaded) {
+    auto hidden = loaded.header.hidden_size;
+
+    for (int i = 0; i < perspectives(loaded.header); i++) {
+        if (!output_lanes_fit_int32(loaded.output_weights + i * hidden, hidden))
+            return false;
+    }
+    return true;
+}
+
+// Point the parameters straight into a pre-quantized image, which has to outlive the network
+bool alias_quantized(char const *data, std::size_t size, LoadedNetwork &loaded) {
+    std::size_t input = loaded.header.input_size, hidden = loaded.header.hidden_size;
+    std::size_t weights = input * hidden + hidden + perspectives(loaded.header) * hidden;
+
+    if (size != weights * sizeof(int16_t) + sizeof(int32_t))
+        return false;
+
+    loaded.hidden_weights = reinterpret_cast<int16_t const *>(data);
+    loaded.hidden_biases  = loaded.hidden_weights + input * hidden;
+    loaded.output_weights = loaded.hidden_biases + hidden;
+    memcpy(&loaded.output_bias, data + weights * sizeof(int16_t), sizeof(int32_t));
+
+    return select_kernels(loaded.kernels, hidden, output_is_int32_safe(loaded));
+}
+
+bool read_network(char const *data, std::size_t size, LoadedNetwork &loaded) {
+    auto &header = loaded.header;
+
+    if (size >= sizeof(NetworkHeader) && !memcmp(data, NetworkHeader().magic, 4)) {
+        memcpy(&header, data, sizeof(NetworkHeader));
+        data += sizeof(NetworkHeader);
+        size -= sizeof(NetworkHeader);
+
+        if (!header_is_supported(header))
+            return false;
+
+        if (header.weight_type == WEIGHTS_INT16)
+            return alias_quantized(data, size, loaded);
+    } else {
+        if (size < sizeof(uint32_t))
+            return false;
+
+        memcpy(&header.hash, data, sizeof(uint32_t));
+        data += sizeof(uint32_t);
+        size -= sizeof(uint32_t);
+    }
+
+    std::size_t input = header.input_size, hidden = header.hidden_size;
+    std::size_t parameters = input * hidden + hidden + perspectives(header) * hidden + 1;
+
+    if (size != parameters * sizeof(float))
+        return false;
+
+    loaded.storage = make_aligned_buffer(parameters);
+
+    auto weights = reinterpret_cast<float const *>(data);
+    auto storage = loaded.storage.get();
+
+    for (std::size_t i = 0; i < parameters - 1; i++) {
+        float weight;
+        memcpy(&weight, weights + i, sizeof(float));
+        storage[i] = quantize(weight, i < input * hidden + hidden ? header.hidden_scale : header.output_scale);
+    }
+
+    float bias;
+    memcpy(&bias, weights + parameters - 1, sizeof(float));
+
+    loaded.hidden_weights = storage;
+    loaded.hidden_biases  = loaded.hidden_weights + input * hidden;
+    loaded.output_weights = loaded.hidden_biases + hidden;
+    loaded.output_bias    = round(bias * header.output_scale);
+
+    return select_kernels(loaded.kernels, hidden, output_is_int32_safe(loaded));
+}
+
+bool load_network(char const *data, std::size_t size, std::shared_ptr<char const> mapping = nullptr) {
+    LoadedNetwork loaded;
+
+    if (!read_network(data, size, loaded))
+        return false;
+
+    if (loaded.header.weight_type == WEIGHTS_INT16)
+        loaded.mapping = std::move(mapping);
+
+    net = std::move(loaded);
+    net_generation++;
+    return true;
+}
+
+std::shared_ptr<char const> map_file(std::string const &path, std::size_t &size) {
+#if defined(__unix__) || defined(__APPLE__)
+    auto fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat info;
+    auto data = MAP_FAILED;
+
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    size = info.st_size;
+    return std::shared_ptr<char const>(static_cast<char const *>(data), [size](char const *p) { munmap(const_cast<char *>(p), size); });
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return nullptr;
+
+    size = file.tellg();
+    auto data = std::shared_ptr<char>(new (std::align_val_t(64)) char[size], [](char *p) { ::operator delete[](p, std::align_val_t(64)); });
+
+    file.seekg(0);
+    if (!file.read(data.get(), size))
+        return nullptr;
+    return data;
+#endif
+}
 }
 
 void Network::init() {
-    auto data = reinterpret_cast<const float *>(gNetworkData);
+    if (!load_network(reinterpret_cast<char const *>(gNetworkData), gNetworkSize)) {
+        std::cerr << "Embedded network " << EVALFILE << " is not supported" << std::endl;
+        std::terminate();
+    }
+}
+
+bool Network::load(std::string const &path) {
+    std::size_t size = 0;
+    auto mapping     = map_file(path, size);
+
+    if (!mapping)
+        return false;
+    return load_network(mapping.get(), size, mapping);
+}
+
+bool Network::save_quantized(std::string const &path) {
+    std::ofstream file(path, std::ios::binary);
+
+    auto header        = net.header;
+    header.weight_type = WEIGHTS_INT16;
+
+    std::size_t input = header.input_size, hidden = header.hidden_size;
+
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    file.write(reinterpret_cast<char const *>(net.hidden_weights), input * hidden * sizeof(int16_t));
+    file.write(reinterpret_cast<char const *>(net.hidden_biases), hidden * sizeof(int16_t));
+    file.write(reinterpret_cast<char const *>(net.output_weights), perspectives(header) * hidden * sizeof(int16_t));
+    file.write(reinterpret_cast<char const *>(&net.output_bias), sizeof(int32_t));
+    return bool(file);
+}
+
+std::uint32_t Network::get_hash() {
+    return net.header.hash;
+}
+
+bool Network::output_fits_int32() {
+    return output_is_int32_safe(net);
+}
+
+std::string Network::get_arch() {
+    auto const &header = net.header;
+    auto arch          = std::to_string(header.input_size) + "x" + std::to_string(header.hidden_size) + "x" + std::to_string(header.output_size);
+    return header.feature_set == FEATURES_KING_BUCKETS ? arch + "-kb" : arch;
+}
 
-    memcpy(&hash, data, sizeof(uint32_t));
-    data++;
+Network &Network::operator=(Network const &other) {
+    if (this == &other)
+        return *this;
 
-    for (size_t i = 0; i < INPUT_SIZE; i++) {
-        for (size_t j = 0; j < HIDDEN_SIZE; j++) {
-            hidden_weights[i][j] = quantize(*data++);
+    // Piece-square nets never compute the black perspective, only perspectives in use bound the copy
+    std::array<int, 2> pending = { other.pending_updates(CLR_WHITE), 0 };
+    if (net.header.feature_set == FEATURES_KING_BUCKETS)
+        pending[CLR_BLACK] = other.pending_updates(CLR_BLACK);
+
+    auto distance = std::max(pending[CLR_WHITE], pending[CLR_BLACK]);
+    for (int i = 0; i <= distance; i++) {
+        auto const &source = other.accumulators[(other.top - distance + i) & (STACK_SIZE - 1)];
+        auto &dest         = accumulators[i];
+
+        dest.updates  = source.updates;
+        dest.buckets  = source.buckets;
+        dest.computed = { false, false };
+    }
+
+    // Only the nearest computed accumulator of each perspective is needed to materialize the top
+    for (auto perspective : { CLR_WHITE, CLR_BLACK }) {
+        auto const &source = other.accumulators[(other.top - pending[perspective]) & (STACK_SIZE - 1)];
+        auto &dest         = accumulators[distance - pending[perspective]];
+
+        if (source.computed[perspective]) {
+            dest.neurons[perspective]  = source.neurons[perspective];
+            dest.computed[perspective] = true;
         }
     }
 
-    for (size_t i = 0; i < HIDDEN_SIZE; i++)
-        hidden_biases[i] = quantize(*data++);
+    top    = distance;
+    height = distance + 1;
+    return *this;
+}
+
+bool Network::update_hidden_layer(NetworkUpdateList const &updates, Square white_king, Square black_king) {
+    auto const &parent = accumulators[top];
 
-    for (size_t i = 0; i < HIDDEN_SIZE; i++)
-        output_weights[i] = quantize(*data++);
+    top    = (top + 1) & (STACK_SIZE - 1);
+    height = std::min(height + 1, STACK_SIZE);
 
-    output_bias = quantize(*data);
+    auto &entry    = accumulators[top];
+    entry.updates  = updates;
+    entry.computed = { false, false };
+
+    if (net.header.feature_set != FEATURES_KING_BUCKETS) {
+        entry.buckets = { 0, 0 };
+        return true;
+    }
+
+    entry.buckets = { static_cast<uint8_t>(calculate_king_bucket(white_king, CLR_WHITE)),
+                      static_cast<uint8_t>(calculate_king_bucket(black_king, CLR_BLACK)) };
+    return entry.buckets == parent.buckets;
 }
 
-void Network::update_hidden_layer(NetworkUpdateList const &updates) {
-    hidden_neurons.push_back(hidden_neurons.back());
+void Network::refresh_king_buckets(NetworkInput const &input) {
+    auto const &parent = accumulators[(top - 1) & (STACK_SIZE - 1)];
 
-    for (auto const &update : updates) {
-        for (std::size_t i = 0; i < hidden_neurons.back().size(); i++)
-            hidden_neurons.back()[i] += update.coeff * hidden_weights[update.index][i];
+    for (auto perspective : { CLR_WHITE, CLR_BLACK }) {
+        if (accumulators[top].buckets[perspective] != parent.buckets[perspective])
+            refresh(input, perspective);
     }
 }
 
-int16_t Network::calculate_last_layer() {
-    int64_t sum = 0;
+bool Network::materialize() {
+    for (auto perspective : { CLR_WHITE, CLR_BLACK }) {
+        if (perspective == CLR_BLACK && net.header.feature_set != FEATURES_KING_BUCKETS)
+            break;
+
+        auto distance = pending_updates(perspective);
+
+        if (!accumulators[(top - distance) & (STACK_SIZE - 1)].computed[perspective])
+            return false;
+
+        for (; distance > 0; distance--) {
+            auto &parent = accumulators[(top - distance) & (STACK_SIZE - 1)];
+            auto &child  = accumulators[(top - distance + 1) & (STACK_SIZE - 1)];
+
+            // A bucket change refreshes the child right away, so both share the bucket here
+            FeatureList added, removed;
+            for (auto const &update : child.updates) {
+                auto index = calculate_input_index(update.sq, update.piece, perspective, child.buckets[perspective]);
+                (update.coeff == InputUpdate::Addition ? added : removed).push_back(index);
+            }
+
+            net.kernels.apply_changes(parent.neurons[perspective].data(), child.neurons[perspective].data(), net.hidden_weights, added, removed);
+            child.computed[perspective] = true;
+        }
+    }
+    return true;
+}
+
+int16_t Network::calculate_last_layer(Color side) {
+    auto const &neurons = accumulators[top].neurons;
+    auto hidden         = net.header.hidden_size;
+    int64_t sum         = net.output_bias;
 
-    for (std::size_t k = 0; k < output_weights.size(); k++)
-        sum += std::max<int64_t>(hidden_neurons.back()[k], 0) * output_weights[k];
-    sum += output_bias;
+    if (net.header.feature_set == FEATURES_KING_BUCKETS) {
+        sum += net.kernels.output_dot(neurons[side].data(), net.output_weights);
+        sum += net.kernels.output_dot(neurons[!side].data(), net.output_weights + hidden);
+    } else
+        sum += net.kernels.output_dot(neurons[CLR_WHITE].data(), net.output_weights);
 
-    return sum / Q_PRECISION / Q_PRECISION;
+    int16_t eval = sum / static_cast<int64_t>(net.header.hidden_scale) / static_cast<int64_t>(net.header.output_scale);
+    return side == CLR_WHITE || net.header.feature_set == FEATURES_KING_BUCKETS ? eval : -eval;
 }
 
-int16_t Network::feed(NetworkInput const &sample) {
-    hidden_neurons.back().fill(0);
+Network::OutputCheck Network::check_output_layer() const {
+    auto const &neurons = accumulators[top].neurons;
+    auto hidden         = net.header.hidden_size;
+    OutputCheck sums;
 
-    for (auto index : sample) {
-        for (std::size_t i = 0; i < HIDDEN_SIZE; i++)
-            hidden_neurons.back()[i] += hidden_weights[index][i];
+    for (int i = 0; i < perspectives(net.header); i++) {
+        sums.selected += net.kernels.output_dot(neurons[i].data(), net.output_weights + i * hidden);
+        sums.vector += net.kernels.output_dot_vector(neurons[i].data(), net.output_weights + i * hidden);
+        sums.scalar += net.kernels.output_dot_scalar(neurons[i].data(), net.output_weights + i * hidden);
     }
+    return sums;
+}
+
+void Network::recalculate_hidden_layer(NetworkInput const &input) {
+    auto &entry = accumulators[top];
 
-    for (std::size_t i = 0; i < hidden_neurons.back().size(); i++)
-        hidden_neurons.back()[i] += hidden_biases[i];
+    height         = 1;
+    entry.computed = { false, false };
 
-    return calculate_last_layer();
+    // Positions can be set up before the first network is loaded, they get recalculated on evaluation
+    if (net_generation == 0)
+        return;
+
+    if (net.header.feature_set == FEATURES_KING_BUCKETS) {
+        auto white_king = input[PCE_WKING], black_king = input[PCE_BKING];
+
+        entry.buckets = { static_cast<uint8_t>(white_king ? calculate_king_bucket(get_lsb(white_king), CLR_WHITE) : 0),
+                          static_cast<uint8_t>(black_king ? calculate_king_bucket(get_lsb(black_king), CLR_BLACK) : 0) };
+        refresh(input, CLR_WHITE);
+        refresh(input, CLR_BLACK);
+    } else {
+        entry.buckets = { 0, 0 };
+        refresh(input, CLR_WHITE);
+    }
 }
 
-std::array<std::array<int16_t, Network::HIDDEN_SIZE>, Network::INPUT_SIZE> Network::hidden_weights;
-std::array<int16_t, Network::HIDDEN_SIZE> Network::hidden_biases;
-std::array<int16_t, Network::HIDDEN_SIZE> Network::output_weights;
-int16_t Network::output_bias;
-std::uint32_t Network::hash;
\ No newline at end of file
+void Network::refresh(NetworkInput const &input, Color perspective) {
+    auto &acc    = accumulators[top];
+    auto bucket  = acc.buckets[perspective];
+    auto &cached = refresh_entries[perspective][bucket];
+
+    if (cached.generation != net_generation) {
+        std::copy_n(net.hidden_biases, net.header.hidden_size, cached.neurons.begin());
+        cached.pieces.fill(0);
+        cached.generation = net_generation;
+    }
+
+    FeatureList added, removed;
+    for (int i = 0; i < PCE_TOTAL; i++) {
+        auto piece = static_cast<Piece>(i);
+        auto adds  = input[i] & ~cached.pieces[i];
+        auto rems  = cached.pieces[i] & ~input[i];
+
+        while (adds)
+            added.push_back(calculate_input_index(pop_lsb(adds), piece, perspective, bucket));
+
+        while (rems)
+            removed.push_back(calculate_input_index(pop_lsb(rems), piece, perspective, bucket));
+    }
+
+    net.kernels.apply_changes(cached.neurons.data(), cached.neurons.data(), net.hidden_weights, added, removed);
+    cached.pieces = input;
+
+    acc.neurons[perspective]  = cached.neurons;
+    acc.computed[perspective] = true;
+}
@@ -16,50 +16,146 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #pragma once
-#include <vector>
-
 #include "net_input.h"
 #include "fixed_list.h"
 
+#include <string>
+
+enum FeatureSet : uint32_t {
+    FEATURES_PSQ,         // 768 piece-square inputs from white's view, the output is white-relative
+    FEATURES_KING_BUCKETS // 768 inputs per king bucket for each side's view, the output is side-relative
+};
+
+enum WeightType : uint32_t {
+    WEIGHTS_FLOAT32, // quantized to int16 while loading
+    WEIGHTS_INT16    // already quantized, used in place (output bias is int32)
+};
+
+// Header of a versioned network file, parameters follow at offset sizeof(NetworkHeader) in this order:
+// hidden weights [input][hidden], hidden biases [hidden], output weights [perspectives][hidden], output bias.
+// King-bucketed nets have two perspectives, the side to move's accumulator comes first in the output layer.
+// Hidden parameters are scaled by hidden_scale, output parameters by output_scale.
+// Files without the magic are read as the original raw 768x512x1 float format
+struct NetworkHeader {
+    char magic[4]          = { 'B', 'G', 'N', 'N' };
+    uint32_t version       = 1;
+    uint32_t hash          = 0;
+    FeatureSet feature_set = FEATURES_PSQ;
+    uint32_t input_size    = 768;
+    uint32_t hidden_size   = 512;
+    uint32_t output_size   = 1;
+    uint32_t hidden_scale  = 64;
+    uint32_t output_scale  = 64;
+    WeightType weight_type = WEIGHTS_FLOAT32;
+    uint32_t reserved[6]   = {};
+};
+
+static_assert(sizeof(NetworkHeader) == 64);
+
 class Network {
 public:
-    static constexpr int INPUT_SIZE  = 768;
-    static constexpr int HIDDEN_SIZE = 512;
-    static constexpr int OUTPUT_SIZE = 1;
+    // Largest hidden layer an accumulator can hold, loaded nets may use any supported size up to it
+    static constexpr int MAX_HIDDEN_SIZE = 512;
+
+    // Accumulators kept for reverting moves, a full search (MAX_PLY) plus recent game history.
+    // Older ones are overwritten and recomputed from scratch if a move ever reverts past them
+    static constexpr int STACK_SIZE = 128;
+
+    static_assert((STACK_SIZE & (STACK_SIZE - 1)) == 0);
 
     Network() {
-        hidden_neurons.push_back({});
-        hidden_neurons.back().fill(0.0f);
+        for (auto &neurons : accumulators[top].neurons)
+            neurons.fill(0);
+    }
+
+    // Copies only carry the current accumulator (or its pending updates since the nearest computed one),
+    // reverting past it falls back to a refresh
+    Network(Network const &other) {
+        *this = other;
     }
 
-    int16_t calculate_last_layer();
+    Network &operator=(Network const &);
 
-    int16_t feed(NetworkInput const &);
+    // Evaluation for the side to move, requires the current accumulator to be materialized
+    int16_t calculate_last_layer(Color side);
 
-    void update_hidden_layer(NetworkUpdateList const &);
+    // Output layer sums of the materialized accumulator from the selected, vectorized and scalar kernels
+    struct OutputCheck {
+        int64_t selected = 0, vector = 0, scalar = 0;
+    };
+    OutputCheck check_output_layer() const;
 
-    void revert_hidden_updates() {
-        hidden_neurons.pop_back();
-    }
+    // Records the updates of a move, they are only applied once the position is evaluated.
+    // Returns false if a king moved to another bucket and refresh_king_buckets has to be called
+    bool update_hidden_layer(NetworkUpdateList const &, Square white_king, Square black_king);
+
+    // Rebuild the perspectives whose king bucket changed with the last move
+    void refresh_king_buckets(NetworkInput const &);
 
-    void recalculate_hidden_layer(NetworkInput const &input) {
-        hidden_neurons.clear();
-        hidden_neurons.push_back({});
-        feed(input);
+    // Apply pending updates from the nearest computed accumulator of each perspective.
+    // Returns false if one is not stored anymore and the layer needs a recalculation
+    bool materialize();
+
+    // Returns false if the previous accumulator is no longer stored and needs a recalculation
+    bool revert_hidden_updates() {
+        if (height == 1)
+            return false;
+
+        top = (top - 1) & (STACK_SIZE - 1);
+        height--;
+        return true;
     }
 
+    void recalculate_hidden_layer(NetworkInput const &);
+
+    // Load the embedded network
     static void init();
 
-    static std::uint32_t get_hash() {
-        return hash;
-    }
+    // Load a network file, keeps the current network and returns false if it can't be used.
+    // Pre-quantized files are memory mapped and used without a copy
+    static bool load(std::string const &path);
+
+    // Write the loaded network as a pre-quantized int16 file
+    static bool save_quantized(std::string const &path);
+
+    static std::uint32_t get_hash();
+
+    // Whether the loaded output weights let the vectorized output layer accumulate on int32 lanes
+    static bool output_fits_int32();
+
+    // Layer sizes of the loaded network, as "768x512x1", king-bucketed nets are suffixed with "-kb"
+    static std::string get_arch();
 
 private:
-    std::vector<std::array<int16_t, HIDDEN_SIZE>> hidden_neurons;
+    // One accumulator per perspective, piece-square nets only use the white one
+    struct alignas(64) Accumulator {
+        std::array<std::array<int16_t, MAX_HIDDEN_SIZE>, 2> neurons;
+        NetworkUpdateList updates;
+        std::array<uint8_t, 2> buckets = {};
+        std::array<bool, 2> computed   = {};
+    };
+
+    // Distance from the top to the nearest computed accumulator of a perspective, or to the bottom of the stack
+    int pending_updates(Color perspective) const {
+        auto distance = 0;
+        while (distance < height - 1 && !accumulators[(top - distance) & (STACK_SIZE - 1)].computed[perspective])
+            distance++;
+        return distance;
+    }
+
+    // Rebuild one perspective of the current accumulator from the board
+    void refresh(NetworkInput const &, Color perspective);
+
+    // Last recalculated accumulator of a perspective and king bucket, and the board it was built from.
+    // Not copied along with the network, every thread keeps its own
+    struct RefreshEntry {
+        alignas(64) std::array<int16_t, MAX_HIDDEN_SIZE> neurons;
+        NetworkInput pieces;
+        std::uint32_t generation = 0;
+    };
 
-    static std::array<std::array<int16_t, HIDDEN_SIZE>, INPUT_SIZE> hidden_weights;
-    static std::array<int16_t, HIDDEN_SIZE> hidden_biases;
-    static std::array<int16_t, HIDDEN_SIZE> output_weights;
-    static int16_t output_bias;
-    static std::uint32_t hash;
+    std::array<Accumulator, STACK_SIZE> accumulators;
+    std::array<std::array<RefreshEntry, KING_BUCKETS>, 2> refresh_entries;
+    int top    = 0;
+    int height = 1;
 };
\ No newline at end of file
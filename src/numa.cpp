@@ -0,0 +1,162 @@
+/*
+  Bit-Genie is an open-source, UCI-compliant chess engine written by
+  Aryan Parekh - https://github.com/Aryan1508/Bit-Genie
+
+  Bit-Genie is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Bit-Genie is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "numa.h"
+
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+// Parse a sysfs id list, as "0" or "0-3,8-11"
+std::vector<int> read_id_list(std::string const &path) {
+    std::ifstream file(path);
+    std::vector<int> ids;
+
+    for (std::string range; std::getline(file, range, ',');) {
+        int first = 0, last = 0;
+        char dash = 0;
+        std::istringstream stream(range);
+
+        if (!(stream >> first))
+            continue;
+
+        if (!(stream >> dash >> last))
+            last = first;
+
+        for (int id = first; id <= last; id++)
+            ids.push_back(id);
+    }
+    return ids;
+}
+
+#if defined(__linux__)
+struct NumaNode {
+    int id;
+    std::vector<int> cores;
+};
+
+// Nodes with the cores this process may run on, a single node -1 if the topology is unknown
+std::vector<NumaNode> usable_nodes() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return {};
+
+    auto usable = [&](std::vector<int> const &cores) {
+        std::vector<int> result;
+        for (auto core : cores)
+            if (core < CPU_SETSIZE && CPU_ISSET(core, &allowed))
+                result.push_back(core);
+        return result;
+    };
+
+    std::vector<NumaNode> nodes;
+    for (auto node : numa_nodes()) {
+        auto cores = usable(read_id_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+        if (!cores.empty())
+            nodes.push_back({ node, cores });
+    }
+
+    if (nodes.empty()) {
+        std::vector<int> cores;
+        for (int core = 0; core < CPU_SETSIZE; core++)
+            if (CPU_ISSET(core, &allowed))
+                cores.push_back(core);
+        nodes.push_back({ -1, cores });
+    }
+    return nodes;
+}
+
+// Allocations of the calling thread come from this node while it has free memory
+void prefer_node(int node) {
+    constexpr int PREFERRED_POLICY = 1; // MPOL_PREFERRED
+
+    unsigned long mask[16] = {};
+    if (node < 0 || node >= int(sizeof(mask) * 8))
+        return;
+
+    mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    syscall(SYS_set_mempolicy, PREFERRED_POLICY, mask, sizeof(mask) * 8 + 1);
+}
+#endif
+}
+
+std::vector<int> numa_nodes() {
+    return read_id_list("/sys/devices/system/node/online");
+}
+
+std::string numa_topology() {
+#if defined(__linux__)
+    auto nodes = usable_nodes();
+    auto cores = 0;
+    for (auto const &node : nodes)
+        cores += node.cores.size();
+
+    return std::to_string(nodes.front().id == -1 ? 0 : nodes.size()) + " NUMA nodes, " + std::to_string(cores) + " cores";
+#else
+    return "unknown topology";
+#endif
+}
+
+int bind_search_thread(std::size_t index, ThreadBinding binding) {
+#if defined(__linux__)
+    if (binding == BINDING_NONE)
+        return -1;
+
+    auto nodes = usable_nodes();
+    if (nodes.empty() || nodes.front().cores.empty())
+        return -1;
+
+    auto node = &nodes.front();
+    auto core = 0;
+
+    if (binding == BINDING_SPREAD) {
+        node = &nodes[index % nodes.size()];
+        core = node->cores[index / nodes.size() % node->cores.size()];
+    } else {
+        auto total = 0ul;
+        for (auto const &n : nodes)
+            total += n.cores.size();
+
+        auto slot = index % total;
+        while (slot >= node->cores.size())
+            slot -= node++->cores.size();
+        core = node->cores[slot];
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        return -1;
+
+    if (nodes.size() > 1)
+        prefer_node(node->id);
+    return node->id;
+#else
+    (void)index;
+    (void)binding;
+    return -1;
+#endif
+}
@@ -0,0 +1,38 @@
+/*
+  Bit-Genie is an open-source, UCI-compliant chess engine written by
+  Aryan Parekh - https://github.com/Aryan1508/Bit-Genie
+
+  Bit-Genie is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Bit-Genie is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <string>
+#include <vector>
+
+// Where search threads run. Spread puts consecutive threads on different NUMA nodes,
+// compact fills the cores of one node before moving on to the next
+enum ThreadBinding {
+    BINDING_NONE,
+    BINDING_SPREAD,
+    BINDING_COMPACT
+};
+
+// Online NUMA nodes, empty where the topology is unknown
+std::vector<int> numa_nodes();
+
+// Number of nodes and cores threads can be bound to, as "2 NUMA nodes, 64 cores"
+std::string numa_topology();
+
+// Pin the calling thread to the core picked for search thread index, and prefer memory of that core's
+// node for everything it allocates from now on. Returns the node, or -1 if the thread is left unbound
+int bind_search_thread(std::size_t index, ThreadBinding);
@@ -0,0 +1,64 @@
+/*
+  Bit-Genie is an open-source, UCI-compliant chess engine written by
+  Aryan Parekh - https://github.com/Aryan1508/Bit-Genie
+
+  Bit-Genie is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Bit-Genie is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "pext.h"
+
+#if defined(__BMI2__)
+#include "magicmoves.hpp"
+
+PextSquare PEXT_BISHOP[64];
+PextSquare PEXT_ROOK[64];
+
+namespace {
+uint16_t bishop_table[5248];
+uint16_t rook_table[102400];
+
+// Attacks of a slider moving in the given directions, stopping at the first blocker
+uint64_t slider_attacks(int sq, uint64_t occ, int const (&steps)[4][2]) {
+    uint64_t attacks = 0;
+    for (auto const &step : steps) {
+        for (int f = sq % 8 + step[0], r = sq / 8 + step[1]; f >= 0 && f < 8 && r >= 0 && r < 8; f += step[0], r += step[1]) {
+            attacks |= 1ull << (r * 8 + f);
+            if (occ & (1ull << (r * 8 + f)))
+                break;
+        }
+    }
+    return attacks;
+}
+
+template <typename Mask>
+void fill_pext_table(PextSquare (&entries)[64], uint16_t *table, Mask const (&masks)[64], int const (&steps)[4][2]) {
+    for (int sq = 0; sq < 64; sq++) {
+        auto &entry   = entries[sq];
+        entry.attacks = table;
+        entry.mask    = masks[sq];
+        entry.rays    = slider_attacks(sq, 0, steps);
+
+        for (uint64_t index = 0; index < (1ull << __builtin_popcountll(entry.mask)); index++)
+            *table++ = _pext_u64(slider_attacks(sq, _pdep_u64(index, entry.mask), steps), entry.rays);
+    }
+}
+}
+
+void init_pext() {
+    constexpr int bishop_steps[4][2]{ { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+    constexpr int rook_steps[4][2]{ { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+
+    fill_pext_table(PEXT_BISHOP, bishop_table, magicmoves_b_mask, bishop_steps);
+    fill_pext_table(PEXT_ROOK, rook_table, magicmoves_r_mask, rook_steps);
+}
+#endif
@@ -0,0 +1,40 @@
+/*
+  Bit-Genie is an open-source, UCI-compliant chess engine written by
+  Aryan Parekh - https://github.com/Aryan1508/Bit-Genie
+
+  Bit-Genie is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Bit-Genie is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#if defined(__BMI2__)
+#include <immintrin.h>
+#include <stdint.h>
+
+// Slider attacks for BMI2 builds. PEXT of the occupancy under the relevant-blocker mask is the table index,
+// and entries hold the attack set compressed to the bits of the square's empty-board rays (at most 14),
+// which PDEP expands again. The rook table takes 200 KB instead of the 800 KB of the magic one
+struct PextSquare {
+    uint16_t const *attacks;
+    uint64_t mask;
+    uint64_t rays;
+};
+
+extern PextSquare PEXT_BISHOP[64];
+extern PextSquare PEXT_ROOK[64];
+
+inline uint64_t pext_attacks(PextSquare const &entry, uint64_t occ) {
+    return _pdep_u64(entry.attacks[_pext_u64(occ, entry.mask)], entry.rays);
+}
+
+void init_pext();
+#endif
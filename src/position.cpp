@@ -19,18 +19,34 @@
 #include "attacks.h"
 #include "stringparse.h"
 
+#include <algorithm>
+
 Position::Position() {
     set_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
 }
 
+Position &Position::operator=(Position const &other) {
+    if (this == &other)
+        return *this;
+
+    std::copy_n(other.history.begin(), other.history_ply, history.begin());
+    pieces       = other.pieces;
+    bitboards    = other.bitboards;
+    colors       = other.colors;
+    network      = other.network;
+    hash         = other.hash;
+    castle_rooks = other.castle_rooks;
+    halfmoves    = other.halfmoves;
+    history_ply  = other.history_ply;
+    ep_sq        = other.ep_sq;
+    side         = other.side;
+    return *this;
+}
+
 NetworkInput Position::to_net_input() const {
     NetworkInput input;
-    for (auto sq = SQ_A1; sq < SQ_TOTAL; sq++) {
-        auto pce = get_piece(sq);
-        if (pce != PCE_NULL) {
-            input.push_back(calculate_input_index(sq, pce));
-        }
-    }
+    for (int i = 0; i < PCE_TOTAL; i++)
+        input[i] = get_bb(static_cast<Piece>(i));
     return input;
 }
 
@@ -68,6 +84,8 @@ bool Position::drawn() const {
 }
 
 int Position::static_evaluation() {
-    auto eval = static_cast<int>(network.calculate_last_layer());
-    return side == CLR_WHITE ? eval : -eval;
+    if (!network.materialize())
+        network.recalculate_hidden_layer(to_net_input());
+
+    return network.calculate_last_layer(side);
 }
\ No newline at end of file
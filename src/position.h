@@ -42,15 +42,25 @@ private:
 public:
     Position();
 
+    // Copies only carry the played part of the undo history
+    Position(Position const &other) {
+        *this = other;
+    }
+
+    Position &operator=(Position const &);
+
     // Set a fen string, does not attempt to validtae it
     void set_fen(std::string_view);
 
     /// Convert board to fen string
     std::string get_fen() const;
 
-    // Generate all legal moves (both noisy and quiet)
+    // Generate all legal moves (both noisy and quiet), through generate_evasions when in check
     void generate_legal(Movelist &) const;
 
+    // Generate all legal moves of a side in check: king moves, captures of a single checker and blocks of its ray
+    void generate_evasions(Movelist &) const;
+
     // Generate all legal noisy moves
     void generate_noisy(Movelist &) const;
 
@@ -124,27 +134,6 @@ public:
         get_piece(a) = PCE_NULL;
     }
 
-    // Add a piece on the board with hash update
-    void add_piece_hash(Square sq, Piece piece) {
-        add_piece(sq, piece);
-        zobrist_hash_piece(hash, piece, sq);
-    }
-
-    // Remove a piece from the board  with hash update
-    Piece remove_piece_hash(Square sq) {
-        Piece piece = remove_piece(sq);
-        zobrist_hash_piece(hash, piece, sq);
-        return piece;
-    }
-
-    // Move piece from square a to square b with hash update
-    void move_piece_hash(Square a, Square b) {
-        Piece piece = get_piece(a);
-        move_piece(a, b);
-        zobrist_hash_piece(hash, piece, a);
-        zobrist_hash_piece(hash, piece, b);
-    }
-
     uint64_t &get_bb(PieceType pt) {
         return bitboards[pt];
     }
@@ -173,6 +162,9 @@ public:
         return hash;
     }
 
+    // Key of the position after a pseudolegal move, without applying it. apply_move takes its key from here
+    uint64_t key_after(Move) const;
+
     uint64_t get_bb() const {
         return colors[CLR_WHITE] | colors[CLR_BLACK];
     }
@@ -199,5 +191,16 @@ public:
 
     NetworkInput to_net_input() const;
 
+    // Rebuild the accumulator from the board, needed after another network is loaded
+    void refresh_network() {
+        network.recalculate_hidden_layer(to_net_input());
+    }
+
+    // Output layer of the current position from every kernel, used by evalcheck
+    Network::OutputCheck check_output_layer() {
+        static_evaluation();
+        return network.check_output_layer();
+    }
+
     friend std::ostream &operator<<(std::ostream &, Position const &);
 };
\ No newline at end of file
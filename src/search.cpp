@@ -38,6 +38,72 @@ int LMP_TABLE[65][2];
 // Late-move reductions
 int LMR_TABLE[65][64];
 
+// Depth-skipping schedule of helper threads, helper i skips depths where (depth + phase) / size is odd.
+// Consecutive helpers take different phases so together they cover every depth ahead of the main thread
+constexpr int SKIP_SIZE[20]{
+    1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4
+};
+constexpr int SKIP_PHASE[20]{
+    0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7
+};
+
+// Number of threads searching each iteration depth
+std::array<std::atomic_int, MAX_PLY + 1> DEPTH_SEARCHERS{};
+
+// Nodes being searched by some thread in ABDADA mode, keyed by position. A direct-mapped table of relaxed
+// atomics: a collision or an early release only costs a duplicated search, never a wrong result
+class BusyTable {
+public:
+    bool busy(uint64_t key) const {
+        return slots[key & (SIZE - 1)].load(std::memory_order_relaxed) == key;
+    }
+
+    void enter(uint64_t key) {
+        slots[key & (SIZE - 1)].store(key, std::memory_order_relaxed);
+    }
+
+    void leave(uint64_t key) {
+        slots[key & (SIZE - 1)].compare_exchange_strong(key, 0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t SIZE = 1 << 15;
+    std::array<std::atomic<uint64_t>, SIZE> slots{};
+};
+
+BusyTable BUSY_NODES;
+
+// Shallower nodes are searched without looking at the busy table
+constexpr int ABDADA_DEPTH = 3;
+
+// Counts a thread in DEPTH_SEARCHERS for the lifetime of one iteration
+class DepthSearcher {
+public:
+    DepthSearcher(int d) : depth(d) {
+        DEPTH_SEARCHERS[depth]++;
+    }
+
+    ~DepthSearcher() {
+        DEPTH_SEARCHERS[depth]--;
+    }
+
+private:
+    int depth;
+};
+
+// The main thread searches every depth, as do all threads in ABDADA mode. Lazy SMP helpers follow their skip schedule and also
+// leave out depths that half of the threads are already working on
+bool skip_depth(SearchInfo const &search, int depth) {
+    if (search.thread_index == 0 || search.smp_mode == SMP_ABDADA)
+        return false;
+
+    auto i = (search.thread_index - 1) % 20;
+    if (((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2)
+        return true;
+
+    return DEPTH_SEARCHERS[depth] >= std::max(1, int(search.thread_count / 2));
+}
+
 void apply_nullmove(SearchInfo &search) {
     search.position.apply_nullmove();
     search.ply++;
@@ -58,12 +124,25 @@ void revert_move(SearchInfo &search) {
     search.ply--;
 }
 
+uint64_t total_nodes(SearchInfo const &search) {
+    if (search.thread_nodes.empty())
+        return search.nodes;
+
+    uint64_t nodes = 0;
+    for (auto counter : search.thread_nodes)
+        nodes += *counter;
+    return nodes;
+}
+
 void update_info(SearchInfo &search) {
-    search.nodes++;
+    ++search.nodes;
     search.seldepth = std::max(search.ply, search.seldepth);
 
-    if ((search.nodes & 2047) == 0)
-        search.limits.update();
+    // The abort flag is only written when a search ends, polling it on every node is a read of a shared cache line
+    if ((search.nodes & search.limits.poll_mask()) == 0)
+        search.limits.update(total_nodes(search));
+    else if (SEARCH_ABORT.load(std::memory_order_relaxed))
+        search.limits.stopped = true;
 }
 
 bool is_pv_node(int alpha, int beta) {
@@ -123,13 +202,13 @@ SearchResult pvs(SearchInfo &search, int depth, int alpha, int beta, bool do_nul
     update_info(search);
 
     SearchResult result;
-    auto picker    = MovePicker(search);
     auto &position = search.position;
-    auto &entry    = retrieve_tt_entry(search);
+    auto entry     = retrieve_tt_entry(search);
     auto pv_node   = is_pv_node(alpha, beta);
     auto in_check  = position.king_in_check();
     auto at_root   = search.ply == 0;
     auto tthit     = entry.hash == position.get_key();
+    auto picker    = MovePicker(search, tthit ? Move(entry.move) : MOVE_NULL);
     auto move_num  = 0;
     auto original  = alpha;
 
@@ -150,6 +229,7 @@ SearchResult pvs(SearchInfo &search, int depth, int alpha, int beta, bool do_nul
             if (entry.score >= beta)
                 update_history_tables_on_cutoff(search, picker.movelist, move, depth);
 
+            search.stats.tt_cutoffs++;
             return { entry.score, move };
         }
     }
@@ -180,18 +260,51 @@ SearchResult pvs(SearchInfo &search, int depth, int alpha, int beta, bool do_nul
     if (!tthit && depth > 3)
         depth--;
 
-    for (Move move; picker.next(move);) {
+    // ABDADA: after the first move, moves another thread is searching are put off until the picker runs out
+    Movelist deferred;
+    size_t deferred_index = 0;
+    auto exclusive        = search.smp_mode == SMP_ABDADA && search.thread_count > 1 && depth >= ABDADA_DEPTH;
+    auto picker_done      = false;
+
+    auto next_move = [&](Move &move) {
+        if (!picker_done && picker.next(move))
+            return true;
+
+        picker_done = true;
+        if (deferred_index == deferred.size())
+            return false;
+
+        move = deferred[deferred_index++];
+        return true;
+    };
+
+    for (Move move; next_move(move);) {
         bool is_quiet = !move_is_capture(position, move);
 
-        if (move_num > LMP_TABLE[depth][improving])
-            break;
+        // Deferred moves were already counted before late-move pruning
+        if (!picker_done && move_num > LMP_TABLE[depth][improving]) {
+            picker_done = true;
+            continue;
+        }
 
         if (depth < 5 && !is_quiet && move.score < SP_TABLE[depth])
             continue;
 
+        auto child = position.key_after(move);
+        if (exclusive && !picker_done && move_num && BUSY_NODES.busy(child)) {
+            deferred.push_back(move);
+            continue;
+        }
+
         move_num++;
+
+        // The child probes the table right away, let the bucket load while the move is applied
+        prefetch_tt_entry(search, child);
         apply_move(search, move);
 
+        if (exclusive)
+            BUSY_NODES.enter(child);
+
         auto score = 0;
         if (depth > 2 && move_num > 3) {
             int R         = LMR_TABLE[depth][std::min(63, move_num)];
@@ -220,6 +333,9 @@ SearchResult pvs(SearchInfo &search, int depth, int alpha, int beta, bool do_nul
             }
         }
 
+        if (exclusive)
+            BUSY_NODES.leave(child);
+
         revert_move(search);
 
         if (search.limits.stopped)
@@ -265,26 +381,79 @@ std::string print_score(int score) {
     return o.str();
 }
 
-void print_info_string(SearchResult result, SearchInfo &search, int depth, std::vector<uint64_t*> const& node_counters) {
-    uint64_t nodes = 0;
-
-    for (const auto &node_counter : node_counters)
-        nodes += *node_counter;
-    
+void print_info_string(SearchResult result, SearchInfo &search, int depth, uint64_t nodes) {
     std::cout << "info";
     std::cout << " depth " << depth;
     std::cout << " seldepth " << search.seldepth;
     std::cout << " nodes " << nodes;
+    auto time = search.limits.stopwatch.elapsed_time().count();
+
     std::cout << " score " << print_score(result.score);
-    std::cout << " time " << search.limits.stopwatch.elapsed_time().count();
+    std::cout << " time " << time;
+    std::cout << " nps " << nodes * 1000 / std::max<int64_t>(time, 1);
+    std::cout << " hashfull " << TT.hashfull();
     std::cout << " pv ";
 
-    for (auto m : TT.extract_pv(search.position, depth)) {
-        std::cout << m << ' ';
+    // The table is shared, another thread may have replaced the root entry with a different move
+    if (result.best_move != MOVE_NULL) {
+        std::cout << result.best_move << ' ';
+        search.position.apply_move(result.best_move);
+
+        for (auto m : TT.extract_pv(search.position, depth - 1)) {
+            std::cout << m << ' ';
+        }
+
+        search.position.revert_move();
     }
 
     std::cout << std::endl;
 }
+
+// A search stopped before depth 1 completes has no root move of its own; answer
+// with the hash move if it is legal here, else the first legal move.
+Move fallback_root_move(SearchInfo &search) {
+    Movelist movelist;
+    search.position.generate_legal(movelist);
+    if (movelist.size() == 0)
+        return MOVE_NULL;
+
+    auto entry     = retrieve_tt_entry(search);
+    auto hash_move = Move(entry.move);
+    if (entry.hash == search.position.get_key() && std::find(movelist.begin(), movelist.end(), hash_move) != movelist.end())
+        return hash_move;
+    return movelist[0];
+}
+
+// Every thread votes for its move with its completed depth and its score above the lowest one.
+// A thread that found a mate is trusted as is, the one with the shortest mate wins
+SearchInfo &select_best_thread(std::vector<std::unique_ptr<SearchInfo>> &threads) {
+    auto min_score = int(MAX_EVAL);
+    for (auto const &thread : threads)
+        if (thread->completed_depth)
+            min_score = std::min(min_score, thread->best.score);
+
+    auto votes = [&](Move move) {
+        int64_t total = 0;
+        for (auto const &thread : threads)
+            if (thread->completed_depth && thread->best.best_move == move)
+                total += int64_t(thread->best.score - min_score + 14) * thread->completed_depth;
+        return total;
+    };
+
+    auto best = threads[0].get();
+    for (auto &thread_data : threads) {
+        auto &thread = *thread_data;
+        if (!thread.completed_depth || thread.best.best_move == MOVE_NULL)
+            continue;
+
+        if (best->completed_depth && best->best.score > MIN_MATE_EVAL) {
+            if (thread.best.score > best->best.score)
+                best = &thread;
+        } else if (thread.best.score > MIN_MATE_EVAL || (thread.best.score >= -MIN_MATE_EVAL && votes(thread.best.best_move) > votes(best->best.best_move)))
+            best = &thread;
+    }
+    return *best;
+}
 }
 
 void init_search_tables() {
@@ -298,7 +467,7 @@ void init_search_tables() {
     }
 }
 
-SearchResult search_position(SearchInfo &search, bool log, std::vector<uint64_t*> node_counters) {
+SearchResult search_position(SearchInfo &search, bool log) {
     Position &position = search.position;
     if (PolyGlot::book.enabled) {
         Move bookmove = PolyGlot::book.probe(position);
@@ -307,8 +476,7 @@ SearchResult search_position(SearchInfo &search, bool log, std::vector<uint64_t*
         }
     }
     SearchResult result;
-    constexpr int window = 12;
-    SEARCH_ABORT         = false;
+    auto window          = 12 + (search.smp_mode == SMP_LAZY ? 2 * int(search.thread_index % 4) : 0);
     auto score           = 0;
     auto best_move       = MOVE_NULL;
 
@@ -318,6 +486,10 @@ SearchResult search_position(SearchInfo &search, bool log, std::vector<uint64_t*
         break;
     }
 #endif
+        if (skip_depth(search, depth))
+            continue;
+
+        DepthSearcher searcher(depth);
         search.ply = search.seldepth = 0;
 
         auto alpha = MIN_EVAL;
@@ -347,16 +519,31 @@ SearchResult search_position(SearchInfo &search, bool log, std::vector<uint64_t*
                 break;
             delta *= 1.5;
         }
-        best_move = result.best_move;
+        best_move              = result.best_move;
+        search.completed_depth = depth;
 
         if (log)
-            print_info_string({ score, best_move }, search, depth, node_counters);
+            print_info_string({ score, best_move }, search, depth, total_nodes(search));
     }
 conc:
-    if (log)
-        std::cout << "bestmove " << best_move << std::endl;
+    if (best_move == MOVE_NULL)
+        best_move = fallback_root_move(search);
+
+    search.best = { score, best_move };
+    return search.best;
+}
 
-    return { score, best_move };
+void report_best_thread(std::vector<std::unique_ptr<SearchInfo>> &threads) {
+    auto &best = select_best_thread(threads);
+
+    if (&best != threads[0].get())
+        print_info_string(best.best, best, best.completed_depth, total_nodes(*threads[0]));
+
+    // MOVE_NULL is only left when the root has no legal move
+    if (best.best.best_move == MOVE_NULL)
+        std::cout << "bestmove 0000" << std::endl;
+    else
+        std::cout << "bestmove " << best.best.best_move << std::endl;
 }
 
 int qsearch(SearchInfo &search, int alpha, int beta) {
@@ -22,6 +22,8 @@
 #include "searchlimits.h"
 
 #include <atomic>
+#include <memory>
+#include <vector>
 #include <string.h>
 
 inline std::atomic_bool SEARCH_ABORT = ATOMIC_VAR_INIT(false);
@@ -32,6 +34,74 @@ constexpr int MATE_EVAL     = 32000;
 constexpr int MAX_PLY       = 64;
 constexpr int MIN_MATE_EVAL = MATE_EVAL - MAX_PLY;
 
+// Counter written by a single thread and read by others while it runs. Relaxed loads and stores
+// keep the increment as cheap as a plain integer, readers only need an eventually exact value
+class RelaxedCounter {
+public:
+    RelaxedCounter(uint64_t initial = 0) : value(initial) {
+    }
+
+    RelaxedCounter(RelaxedCounter const &other) : value(uint64_t(other)) {
+    }
+
+    RelaxedCounter &operator=(RelaxedCounter const &other) {
+        return *this = uint64_t(other);
+    }
+
+    RelaxedCounter &operator=(uint64_t v) {
+        value.store(v, std::memory_order_relaxed);
+        return *this;
+    }
+
+    RelaxedCounter &operator++() {
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return *this;
+    }
+
+    operator uint64_t() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value;
+};
+
+// Counters of one search thread, plain integers since only that thread writes them
+struct SearchStats {
+    uint64_t tt_probes  = 0;
+    uint64_t tt_hits    = 0;
+    uint64_t tt_cutoffs = 0;
+    std::array<uint64_t, TTSTORE_TOTAL> tt_stores = {};
+
+    SearchStats &operator+=(SearchStats const &other) {
+        tt_probes += other.tt_probes;
+        tt_hits += other.tt_hits;
+        tt_cutoffs += other.tt_cutoffs;
+
+        for (int i = 0; i < TTSTORE_TOTAL; i++)
+            tt_stores[i] += other.tt_stores[i];
+        return *this;
+    }
+};
+
+// How search threads share work. Lazy SMP threads only share the transposition table and spread over
+// iteration depths, ABDADA threads search the same depth and defer moves another thread is already searching
+enum SmpMode {
+    SMP_LAZY,
+    SMP_ABDADA
+};
+
+struct SearchResult {
+    int score      = MIN_EVAL;
+    Move best_move = MOVE_NULL;
+
+    SearchResult() = default;
+
+    SearchResult(int best_score, Move best = MOVE_NULL)
+        : score(best_score), best_move(best) {
+    }
+};
+
 struct SearchInfo {
     Position position;
     SearchLimits limits;
@@ -44,9 +114,23 @@ struct SearchInfo {
     CounterHistoryTable counter_history = { 0 };
 
     // Counters
-    uint64_t nodes = 0;
-    int seldepth   = 0;
-    int ply        = 0;
+    RelaxedCounter nodes;
+    int seldepth = 0;
+    int ply      = 0;
+    SearchStats stats;
+
+    // Deepest finished iteration and the result the search ended with
+    int completed_depth = 0;
+    SearchResult best;
+
+    // Position in the thread pool, thread 0 is the main thread
+    size_t thread_index = 0;
+    size_t thread_count = 1;
+    SmpMode smp_mode    = SMP_LAZY;
+
+    // Node counters of every thread in the search. The main thread reports their sum and every thread
+    // enforces node limits on it, so a descheduled main thread can't let the others run past the limit
+    std::vector<RelaxedCounter const *> thread_nodes;
 
 #ifdef FEN_GENERATOR 
     TTable local_tt = TTable(8);
@@ -63,24 +147,9 @@ struct SearchInfo {
     }
 
     void reset_counters() {
-        nodes = seldepth = ply = 0;
-    }
-
-    void copy_history_tables(SearchInfo const &other) {
-        memcpy(history, other.history, sizeof(history));
-        memcpy(capture_history, other.capture_history, sizeof(capture_history));
-        memcpy(counter_history, other.counter_history, sizeof(counter_history));
-    }
-};
-
-struct SearchResult {
-    int score      = MIN_EVAL;
-    Move best_move = MOVE_NULL;
-
-    SearchResult() = default;
-
-    SearchResult(int best_score, Move best = MOVE_NULL)
-        : score(best_score), best_move(best) {
+        nodes = seldepth = ply = completed_depth = 0;
+        stats = SearchStats();
+        best  = SearchResult();
     }
 };
 
@@ -88,23 +157,42 @@ void init_search_tables();
 
 int qsearch(SearchInfo &search, int alpha, int beta);
 
-SearchResult search_position(SearchInfo &, bool log, std::vector<uint64_t*> node_counters = {});
+// log prints an info line for every completed iteration
+SearchResult search_position(SearchInfo &, bool log);
+
+// Print the bestmove of the thread with the most trusted result, once every thread has stopped.
+// Its line is printed as well if it is not the main thread
+void report_best_thread(std::vector<std::unique_ptr<SearchInfo>> &);
 
 #ifndef FEN_GENERATOR 
-inline void add_tt_entry(SearchInfo&, TEntry const& entry) {
-    TT.add(entry);
+inline void add_tt_entry(SearchInfo& search, TEntry const& entry) {
+    search.stats.tt_stores[TT.add(entry)]++;
+}
+
+inline TEntry retrieve_tt_entry(SearchInfo& search) {
+    auto entry = TT.retrieve(search.position);
+    search.stats.tt_probes++;
+    search.stats.tt_hits += entry.hash == search.position.get_key();
+    return entry;
 }
 
-inline TEntry& retrieve_tt_entry(SearchInfo& search) {
-    return TT.retrieve(search.position);
+inline void prefetch_tt_entry(SearchInfo&, uint64_t hash) {
+    TT.prefetch(hash);
 }
 #else 
 inline void add_tt_entry(SearchInfo& search, TEntry const& entry) {
-    search.local_tt.add(entry);
+    search.stats.tt_stores[search.local_tt.add(entry)]++;
+}
+
+inline TEntry retrieve_tt_entry(SearchInfo& search) {
+    auto entry = search.local_tt.retrieve(search.position);
+    search.stats.tt_probes++;
+    search.stats.tt_hits += entry.hash == search.position.get_key();
+    return entry;
 }
 
-inline TEntry& retrieve_tt_entry(SearchInfo& search) {
-    return search.local_tt.retrieve(search.position);
+inline void prefetch_tt_entry(SearchInfo& search, uint64_t hash) {
+    search.local_tt.prefetch(hash);
 }
 
 inline int FEN_GENERATOR_DEPTH = 10;
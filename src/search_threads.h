@@ -16,61 +16,205 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #pragma once
+#include "tt.h"
+#include "numa.h"
 #include "board.h"
 #include "search.h"
 
+#include <chrono>
 #include <thread>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 
+// Search threads are started once and parked between searches. Every thread keeps its own SearchInfo,
+// so history tables carry over from one search to the next and only the position and limits are handed over.
+// The SearchInfo is allocated by its thread, after binding, so it lives on that thread's NUMA node
 class SearchThreadManager {
 public:
     SearchThreadManager() {
         set_threads(1);
     }
 
-    SearchInfo const& get_info() const {
-        return search_data[0];
+    ~SearchThreadManager() {
+        stop();
+        release_workers();
+    }
+
+    size_t get_thread_count() const {
+        return workers.size();
+    }
+
+    // Counters of the last search summed over all threads, only meaningful once it stopped
+    SearchStats get_stats() const {
+        SearchStats stats;
+        for (auto const &thread_data : search_data)
+            stats += thread_data->stats;
+        return stats;
+    }
+
+    uint64_t get_nodes() const {
+        uint64_t nodes = 0;
+        for (auto const &thread_data : search_data)
+            nodes += thread_data->nodes;
+        return nodes;
+    }
+
+    // Time from the last begin until the main thread started searching
+    std::chrono::microseconds get_go_latency() const {
+        return go_latency;
+    }
+
+    // Takes effect with the next search
+    void set_smp_mode(SmpMode mode) {
+        smp_mode = mode;
+    }
+
+    ThreadBinding get_binding() const {
+        return binding;
+    }
+
+    // Threads are bound when they start, so they are restarted with fresh search data
+    void set_binding(ThreadBinding new_binding) {
+        binding = new_binding;
+        set_threads(get_thread_count());
     }
 
     void set_threads(size_t count) {
         stop();
-        threads.resize(count);
+        release_workers();
+
+        search_data.clear();
         search_data.resize(count);
-        node_counters.resize(count);
+        started = 0;
 
-        for(size_t i = 0;i < threads.size();i++)
-            node_counters[i] = &search_data[i].nodes;
+        for (size_t i = 0; i < count; i++)
+            workers.emplace_back(&SearchThreadManager::idle_loop, this, i, search_id);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            idle.wait(lock, [&]() { return started == count; });
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            search_data[i]->thread_index = i;
+            search_data[i]->thread_count = count;
+
+            for (size_t j = 0; j < count; j++)
+                search_data[i]->thread_nodes.push_back(&search_data[j]->nodes);
+        }
     }
 
-    void begin(SearchInfo const &info) {
-        if (is_searching())
-            stop();
+    // report prints the best thread's move once the search ends, as UCI expects
+    void begin(Position const &position, SearchLimits const &limits, bool report = true) {
+        stop();
+        // Only bump the generation once no worker is reading it
+        TT.new_search();
 
         for (auto &thread_data : search_data) {
-            thread_data = info;
+            thread_data->position = position;
+            thread_data->limits   = limits;
+            thread_data->smp_mode = smp_mode;
+            thread_data->reset_counters();
+            memset(thread_data->killers, 0, sizeof(thread_data->killers));
         }
 
-        for (size_t i = 0; i < threads.size(); i++) {
-            auto is_main_thread = i == 0;
-            threads[i]          = std::thread(&search_position, std::ref(search_data[i]), is_main_thread, node_counters);
+        SEARCH_ABORT = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy      = workers.size();
+            reporting = report;
+            go_time   = std::chrono::steady_clock::now();
+            search_id++;
         }
+        wake.notify_all();
+    }
+
+    // Wait until the current search ends by itself
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [&]() { return busy == 0; });
     }
 
+    // Abort the current search and wait until every thread is parked again
     void stop() {
         SEARCH_ABORT = true;
+        wait();
+    }
+
+private:
+    // last_search is taken when the thread is created, a search begun before it runs still wakes it
+    void idle_loop(size_t index, uint64_t last_search) {
+        bind_search_thread(index, binding);
+        auto thread_data = std::make_unique<SearchInfo>();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            search_data[index] = std::move(thread_data);
+            started++;
+        }
+        idle.notify_all();
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return quit || search_id != last_search; });
+
+                if (quit)
+                    return;
 
-        for (auto &thread : threads) {
-            if (thread.joinable())
-                thread.join();
+                last_search = search_id;
+                if (index == 0)
+                    go_latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - go_time);
+            }
+
+            search_position(*search_data[index], index == 0 && reporting);
+
+            // Helpers stop as soon as the main thread is done
+            if (index == 0)
+                SEARCH_ABORT = true;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                // The main thread reports once the helpers are parked
+                if (index == 0 && reporting) {
+                    idle.wait(lock, [&]() { return busy == 1; });
+                    report_best_thread(search_data);
+                }
+                busy--;
+            }
+            idle.notify_all();
         }
     }
 
-    bool is_searching() const {
-        return threads[0].joinable();
+    void release_workers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+
+        for (auto &worker : workers)
+            worker.join();
+
+        workers.clear();
+        quit = false;
     }
 
-private:
-    std::vector<SearchInfo> search_data;
-    std::vector<std::thread> threads;
-    std::vector<uint64_t*> node_counters;
-};
\ No newline at end of file
+    std::vector<std::unique_ptr<SearchInfo>> search_data;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    SmpMode smp_mode      = SMP_LAZY;
+    ThreadBinding binding = BINDING_NONE;
+    uint64_t search_id    = 0;
+    size_t busy           = 0;
+    size_t started        = 0;
+    bool quit             = false;
+    bool reporting        = true;
+
+    std::chrono::steady_clock::time_point go_time;
+    std::chrono::microseconds go_latency{ 0 };
+};
@@ -18,8 +18,8 @@
 #include "searchlimits.h"
 #include "search.h"
 
-void SearchLimits::update() {
-    stopped = SEARCH_ABORT || (time_set && stopwatch.elapsed_time().count() >= movetime);
+void SearchLimits::update(uint64_t nodes) {
+    stopped = SEARCH_ABORT || nodes >= max_nodes || (time_set && stopwatch.elapsed_time().count() >= movetime);
 }
 
 void SearchLimits::set_movetime(int64_t value) {
@@ -19,6 +19,8 @@
 #include "board.h"
 #include "stopwatch.h"
 
+#include <limits>
+
 class SearchLimits {
 public:
     SearchLimits() {
@@ -29,16 +31,25 @@ public:
         stopwatch.reset();
         movetime  = 0;
         max_depth = 64;
+        max_nodes = std::numeric_limits<uint64_t>::max();
         stopped = time_set = false;
     }
 
     void set_movetime(int64_t);
 
-    void update();
+    // Nodes searched so far by all threads
+    void update(uint64_t nodes);
+
+    // Limits are checked every poll_mask + 1 nodes of a thread. A node limit is checked often so go nodes
+    // stops close to it, summing the counters reads every thread's cache line
+    uint64_t poll_mask() const {
+        return max_nodes == std::numeric_limits<uint64_t>::max() ? 1023 : 15;
+    }
 
     StopWatch<> stopwatch;
     int64_t movetime;
     int max_depth;
+    uint64_t max_nodes;
     bool stopped;
     bool time_set;
 };
\ No newline at end of file
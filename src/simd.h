@@ -0,0 +1,224 @@
+/*
+  Bit-Genie is an open-source, UCI-compliant chess engine written by
+  Aryan Parekh - https://github.com/Aryan1508/Bit-Genie
+
+  Bit-Genie is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Bit-Genie is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <stdint.h>
+
+// Thin wrappers over the widest int16 vector unit the build targets.
+// The target is picked at compile time from the -m flags used by the makefile
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+using vec_t   = __m256i;
+using vec32_t = __m256i;
+
+constexpr int VEC_LANES = 16;
+
+inline vec_t vec_load(int16_t const *p) {
+    return _mm256_loadu_si256(reinterpret_cast<vec_t const *>(p));
+}
+
+inline void vec_store(int16_t *p, vec_t v) {
+    _mm256_storeu_si256(reinterpret_cast<vec_t *>(p), v);
+}
+
+inline vec_t vec_add(vec_t a, vec_t b) {
+    return _mm256_add_epi16(a, b);
+}
+
+inline vec_t vec_sub(vec_t a, vec_t b) {
+    return _mm256_sub_epi16(a, b);
+}
+
+inline vec_t vec_zero() {
+    return _mm256_setzero_si256();
+}
+
+inline vec_t vec_max(vec_t a, vec_t b) {
+    return _mm256_max_epi16(a, b);
+}
+
+// Multiply int16 lanes and add adjacent pairs into int32 lanes
+inline vec32_t vec_madd(vec_t a, vec_t b) {
+    return _mm256_madd_epi16(a, b);
+}
+
+inline vec32_t vec_zero32() {
+    return _mm256_setzero_si256();
+}
+
+inline vec32_t vec_add32(vec32_t a, vec32_t b) {
+    return _mm256_add_epi32(a, b);
+}
+
+inline void vec_store32(int32_t *p, vec32_t v) {
+    _mm256_storeu_si256(reinterpret_cast<vec32_t *>(p), v);
+}
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+using vec_t   = __m128i;
+using vec32_t = __m128i;
+
+constexpr int VEC_LANES = 8;
+
+inline vec_t vec_load(int16_t const *p) {
+    return _mm_loadu_si128(reinterpret_cast<vec_t const *>(p));
+}
+
+inline void vec_store(int16_t *p, vec_t v) {
+    _mm_storeu_si128(reinterpret_cast<vec_t *>(p), v);
+}
+
+inline vec_t vec_add(vec_t a, vec_t b) {
+    return _mm_add_epi16(a, b);
+}
+
+inline vec_t vec_sub(vec_t a, vec_t b) {
+    return _mm_sub_epi16(a, b);
+}
+
+inline vec_t vec_zero() {
+    return _mm_setzero_si128();
+}
+
+inline vec_t vec_max(vec_t a, vec_t b) {
+    return _mm_max_epi16(a, b);
+}
+
+// Multiply int16 lanes and add adjacent pairs into int32 lanes
+inline vec32_t vec_madd(vec_t a, vec_t b) {
+    return _mm_madd_epi16(a, b);
+}
+
+inline vec32_t vec_zero32() {
+    return _mm_setzero_si128();
+}
+
+inline vec32_t vec_add32(vec32_t a, vec32_t b) {
+    return _mm_add_epi32(a, b);
+}
+
+inline void vec_store32(int32_t *p, vec32_t v) {
+    _mm_storeu_si128(reinterpret_cast<vec32_t *>(p), v);
+}
+
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+
+using vec_t   = int16x8_t;
+using vec32_t = int32x4_t;
+
+constexpr int VEC_LANES = 8;
+
+inline vec_t vec_load(int16_t const *p) {
+    return vld1q_s16(p);
+}
+
+inline void vec_store(int16_t *p, vec_t v) {
+    vst1q_s16(p, v);
+}
+
+inline vec_t vec_add(vec_t a, vec_t b) {
+    return vaddq_s16(a, b);
+}
+
+inline vec_t vec_sub(vec_t a, vec_t b) {
+    return vsubq_s16(a, b);
+}
+
+inline vec_t vec_zero() {
+    return vdupq_n_s16(0);
+}
+
+inline vec_t vec_max(vec_t a, vec_t b) {
+    return vmaxq_s16(a, b);
+}
+
+// Multiply int16 lanes and add adjacent pairs into int32 lanes
+inline vec32_t vec_madd(vec_t a, vec_t b) {
+    auto lo = vmull_s16(vget_low_s16(a), vget_low_s16(b));
+    auto hi = vmull_s16(vget_high_s16(a), vget_high_s16(b));
+    return vcombine_s32(vpadd_s32(vget_low_s32(lo), vget_high_s32(lo)), vpadd_s32(vget_low_s32(hi), vget_high_s32(hi)));
+}
+
+inline vec32_t vec_zero32() {
+    return vdupq_n_s32(0);
+}
+
+inline vec32_t vec_add32(vec32_t a, vec32_t b) {
+    return vaddq_s32(a, b);
+}
+
+inline void vec_store32(int32_t *p, vec32_t v) {
+    vst1q_s32(p, v);
+}
+
+#else
+using vec_t   = int16_t;
+using vec32_t = int32_t;
+
+constexpr int VEC_LANES = 1;
+
+inline vec_t vec_load(int16_t const *p) {
+    return *p;
+}
+
+inline void vec_store(int16_t *p, vec_t v) {
+    *p = v;
+}
+
+inline vec_t vec_add(vec_t a, vec_t b) {
+    return a + b;
+}
+
+inline vec_t vec_sub(vec_t a, vec_t b) {
+    return a - b;
+}
+
+inline vec_t vec_zero() {
+    return 0;
+}
+
+inline vec_t vec_max(vec_t a, vec_t b) {
+    return a > b ? a : b;
+}
+
+inline vec32_t vec_madd(vec_t a, vec_t b) {
+    return a * b;
+}
+
+inline vec32_t vec_zero32() {
+    return 0;
+}
+
+inline vec32_t vec_add32(vec32_t a, vec32_t b) {
+    return a + b;
+}
+
+inline void vec_store32(int32_t *p, vec32_t v) {
+    *p = v;
+}
+#endif
+
+// Number of int32 lanes produced by vec_madd, input lane k ends up in lane (k % VEC_LANES) / 2
+constexpr int VEC_LANES32 = VEC_LANES > 1 ? VEC_LANES / 2 : 1;
+
+// Number of vectors kept in registers while streaming over a layer
+constexpr int VEC_REGISTERS = 16;
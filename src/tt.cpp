@@ -16,40 +16,188 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "tt.h"
+#include "zobrist.h"
+#include "network.h"
 #include "position.h"
+#include <thread>
+#include <fstream>
 #include <algorithm>
 
 static inline size_t mb_to_b(size_t mb) {
     return mb * 1024 * 1024;
 }
 
+namespace {
+// Saved tables are this header followed by header.entries DiskEntry records
+struct HashFileHeader {
+    char magic[4]          = { 'B', 'G', 'T', 'T' };
+    uint32_t version       = 1;
+    uint32_t network_hash  = 0;
+    uint32_t reserved      = 0;
+    uint64_t zobrist_check = 0;
+    uint64_t entries       = 0;
+};
+
+static_assert(sizeof(HashFileHeader) == 32);
+
+struct DiskEntry {
+    uint64_t hash;
+    uint64_t data;
+};
+
+// Records are streamed through a buffer of this many
+constexpr size_t DISK_BUFFER_ENTRIES = 1 << 16;
+}
+
 TTable::TTable() {
     resize(8);
 }
 
-void TTable::resize(size_t mb) {
-    entries.resize(mb_to_b(mb) / sizeof(TEntry), TEntry());
+void TTable::resize(size_t mb, size_t threads) {
+    buckets.reset();
+    bucket_count = std::max<size_t>(mb_to_b(mb) / sizeof(Bucket), 1);
+    buckets      = allocate_large<Bucket>(bucket_count, memory_info);
+    reset(threads);
+}
+
+TTable &TTable::operator=(TTable const &other) {
+    if (this == &other)
+        return *this;
+
+    if (bucket_count != other.bucket_count) {
+        buckets.reset();
+        bucket_count = other.bucket_count;
+        buckets      = allocate_large<Bucket>(bucket_count, memory_info);
+    }
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        for (int j = 0; j < BUCKET_SIZE; j++) {
+            auto const &source = other.buckets[i].slots[j];
+            buckets[i].slots[j].key.store(source.key.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            buckets[i].slots[j].data.store(source.data.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    generation = other.generation;
+    return *this;
+}
+
+// Nothing probes the table while it is cleared, so plain stores are fine
+void TTable::reset(size_t threads) {
+    threads = std::clamp<size_t>(threads, 1, bucket_count);
+
+    // Thread i clears [i * n / t, (i + 1) * n / t), every range is within the table and none is empty
+    auto clear = [this, threads](size_t i) {
+        auto begin = i * bucket_count / threads;
+        auto end   = (i + 1) * bucket_count / threads;
+        memset(static_cast<void *>(buckets.get() + begin), 0, (end - begin) * sizeof(Bucket));
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++)
+        workers.emplace_back(clear, i);
+
+    clear(0);
+
+    for (auto &worker : workers)
+        worker.join();
+
+    generation = 0;
 }
 
-void TTable::add(Position const &position, Move move, int16_t score, uint8_t depth, TTFlag flag, int16_t seval) {
-    add(TEntry(position.get_key(), score, move, depth, flag, seval));
+TTStore TTable::add(Position const &position, Move move, int16_t score, uint8_t depth, TTFlag flag, int16_t seval) {
+    return add(TEntry(position.get_key(), score, move, depth, flag, seval));
 }
 
-TEntry &TTable::retrieve(Position const &position) {
-    auto hash  = position.get_key();
-    auto index = hash % entries.size();
-    return entries[index];
+TEntry TTable::retrieve(Position const &position) const {
+    return retrieve(position.get_key());
 }
 
-void TTable::add(TEntry const &entry) {
-    auto hash  = entry.hash;
-    auto index = hash % entries.size();
+TEntry TTable::retrieve(uint64_t hash) const {
+    auto &bucket = get_bucket(hash);
 
-    if (entry.flag != TTFLAG_EXACT && hash == entries[index].hash && entry.depth < entries[index].depth - 2)
-        return;
+    for (auto const &slot : bucket.slots) {
+        auto data = slot.data.load(std::memory_order_relaxed);
 
-    if (entry.flag == TTFLAG_EXACT || entry.depth * 3 > entries[index].depth)
-        entries[index] = entry;
+        if ((slot.key.load(std::memory_order_relaxed) ^ data) == hash && data) {
+            auto entry = unpack(data);
+            return TEntry(hash, entry.score, Move(entry.move), entry.depth - 1, static_cast<TTFlag>(entry.genflag & 3), entry.seval);
+        }
+    }
+    return TEntry();
+}
+
+TTStore TTable::add(TEntry const &entry) {
+    auto &bucket = get_bucket(entry.hash);
+    auto move    = entry.move;
+    auto outcome = TTSTORE_UPDATE;
+    Slot *victim = nullptr;
+
+    for (auto &slot : bucket.slots) {
+        auto data = slot.data.load(std::memory_order_relaxed);
+
+        if ((slot.key.load(std::memory_order_relaxed) ^ data) == entry.hash && data) {
+            auto old = unpack(data);
+
+            // Keep a much deeper bound of the same position, it only needs to survive this search
+            if (entry.flag != TTFLAG_EXACT && entry.depth + 1 < old.depth - 2) {
+                old.genflag = generation << 2 | (old.genflag & 3);
+                slot.key.store(entry.hash ^ pack(old), std::memory_order_relaxed);
+                slot.data.store(pack(old), std::memory_order_relaxed);
+                return TTSTORE_KEPT;
+            }
+
+            if (!move)
+                move = old.move;
+            victim = &slot;
+            break;
+        }
+    }
+
+    // Otherwise take an empty slot, or the shallowest one with entries of older searches counting as shallower
+    if (!victim) {
+        auto worth = [&](Slot const &slot) {
+            auto data = unpack(slot.data.load(std::memory_order_relaxed));
+            return data.depth ? data.depth - 4 * data.age(generation) : INT32_MIN;
+        };
+
+        victim          = &bucket.slots[0];
+        auto best_worth = worth(*victim);
+
+        for (auto &slot : bucket.slots) {
+            auto slot_worth = worth(slot);
+            if (slot_worth < best_worth) {
+                victim     = &slot;
+                best_worth = slot_worth;
+            }
+        }
+
+        outcome = best_worth == INT32_MIN ? TTSTORE_EMPTY : TTSTORE_REPLACE;
+    }
+
+    SlotData data{};
+    data.move    = move;
+    data.score   = entry.score;
+    data.seval   = entry.seval;
+    data.depth   = entry.depth + 1;
+    data.genflag = generation << 2 | entry.flag;
+
+    victim->key.store(entry.hash ^ pack(data), std::memory_order_relaxed);
+    victim->data.store(pack(data), std::memory_order_relaxed);
+    return outcome;
+}
+
+int TTable::hashfull() const {
+    auto sampled = std::min<size_t>(bucket_count, 1000 / BUCKET_SIZE);
+    auto used    = 0;
+
+    for (size_t i = 0; i < sampled; i++) {
+        for (auto const &slot : buckets[i].slots) {
+            auto data = unpack(slot.data.load(std::memory_order_relaxed));
+            used += data.depth && !data.age(generation);
+        }
+    }
+    return used * 1000 / (sampled * BUCKET_SIZE);
 }
 
 std::vector<Move> TTable::extract_pv(Position &position, int depth) {
@@ -62,10 +210,10 @@ std::vector<Move> TTable::extract_pv(Position &position, int depth) {
 
     std::vector<Move> pv;
     auto distance = 0;
-    auto entry    = &retrieve(position);
+    auto entry    = retrieve(position);
 
-    while (entry->hash == position.get_key() && depth != 0) {
-        Move pv_move = Move(entry->move);
+    while (entry.hash == position.get_key() && depth != 0) {
+        Move pv_move = Move(entry.move);
         if (move_exists(pv_move)) {
             distance++;
             position.apply_move(pv_move);
@@ -73,10 +221,72 @@ std::vector<Move> TTable::extract_pv(Position &position, int depth) {
             depth--;
         } else
             break;
-        entry = &retrieve(position);
+        entry = retrieve(position);
     }
     while (distance--) {
         position.revert_move();
     }
     return pv;
-}
\ No newline at end of file
+}
+bool TTable::save(std::string const &path) const {
+    std::ofstream file(path, std::ios::binary);
+
+    HashFileHeader header;
+    header.network_hash  = Network::get_hash();
+    header.zobrist_check = zobrist_keys_checksum();
+
+    std::vector<DiskEntry> buffer;
+    buffer.reserve(DISK_BUFFER_ENTRIES);
+
+    auto flush = [&]() {
+        file.write(reinterpret_cast<char const *>(buffer.data()), buffer.size() * sizeof(DiskEntry));
+        header.entries += buffer.size();
+        buffer.clear();
+    };
+
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        for (auto const &slot : buckets[i].slots) {
+            auto data = slot.data.load(std::memory_order_relaxed);
+            if (!data)
+                continue;
+
+            buffer.push_back({ slot.key.load(std::memory_order_relaxed) ^ data, data });
+            if (buffer.size() == DISK_BUFFER_ENTRIES)
+                flush();
+        }
+    }
+    flush();
+
+    file.seekp(0);
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    return bool(file);
+}
+
+bool TTable::load(std::string const &path) {
+    std::ifstream file(path, std::ios::binary);
+    HashFileHeader header, expected;
+
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return false;
+
+    if (memcmp(header.magic, expected.magic, 4) || header.version != expected.version || header.network_hash != Network::get_hash() || header.zobrist_check != zobrist_keys_checksum())
+        return false;
+
+    std::vector<DiskEntry> buffer(DISK_BUFFER_ENTRIES);
+
+    for (uint64_t remaining = header.entries; remaining;) {
+        auto count = std::min<uint64_t>(remaining, DISK_BUFFER_ENTRIES);
+
+        if (!file.read(reinterpret_cast<char *>(buffer.data()), count * sizeof(DiskEntry)))
+            return false;
+
+        for (size_t i = 0; i < count; i++) {
+            auto data = unpack(buffer[i].data);
+            add(TEntry(buffer[i].hash, data.score, Move(data.move), data.depth - 1, static_cast<TTFlag>(data.genflag & 3), data.seval));
+        }
+        remaining -= count;
+    }
+    return true;
+}
@@ -18,7 +18,11 @@
 #pragma once
 #include "board.h"
 #include "move.h"
+#include "memory.h"
+#include <atomic>
+#include <memory>
 #include <vector>
+#include <string.h>
 
 enum TTFlag : uint8_t {
     TTFLAG_LOWER,
@@ -27,6 +31,16 @@ enum TTFlag : uint8_t {
     TTFLAG_NULL = 0
 };
 
+// How a store went, for statistics
+enum TTStore : uint8_t {
+    TTSTORE_EMPTY,   // into an empty slot
+    TTSTORE_UPDATE,  // over the entry of the same position
+    TTSTORE_REPLACE, // evicting another position
+    TTSTORE_KEPT,    // a much deeper entry of the same position was kept instead
+    TTSTORE_TOTAL
+};
+
+// Decoded view of a table entry, hash is the full key of the position on a hit and 0 otherwise
 struct TEntry {
     uint64_t hash = 0;
     int16_t score = 0;
@@ -42,6 +56,9 @@ struct TEntry {
     }
 };
 
+// Entries are stored as two 64 bit words, four to a 64 byte bucket so a probe touches a single cache line.
+// Threads share the table without locks: the words are relaxed atomics and the first one holds hash ^ data,
+// so an entry torn by concurrent writes fails verification and reads as a miss instead of a corrupt hit
 class TTable {
 public:
     TTable();
@@ -50,22 +67,106 @@ public:
         resize(mb);
     }
 
-    void resize(size_t);
+    // Copies duplicate the whole table
+    TTable(TTable const &other) {
+        *this = other;
+    }
+
+    TTable &operator=(TTable const &);
+
+    // Clearing is split over the given number of threads, which also spreads the first touch of every page
+    void resize(size_t mb, size_t threads = 1);
+
+    TTStore add(TEntry const &);
+
+    TTStore add(Position const &, Move, int16_t score, uint8_t depth, TTFlag, int16_t);
 
-    void add(TEntry const &);
+    void reset(size_t threads = 1);
 
-    void add(Position const &, Move, int16_t score, uint8_t depth, TTFlag, int16_t);
+    // Size and kind of memory backing the table, as "64 MB using 2 MB pages"
+    std::string const &get_memory_info() const {
+        return memory_info;
+    }
 
-    void reset() {
-        std::fill(entries.begin(), entries.end(), TEntry());
+    // Age the entries of previous searches so they get replaced first
+    void new_search() {
+        generation = (generation + 1) & GENERATION_MASK;
     }
 
-    TEntry &retrieve(Position const &);
+    TEntry retrieve(Position const &) const;
+
+    TEntry retrieve(uint64_t hash) const;
+
+    // Permille of entries written by the current search, sampled from the first buckets
+    int hashfull() const;
+
+    // Start loading the bucket of a key into cache ahead of a probe
+    void prefetch(uint64_t hash) const {
+        __builtin_prefetch(&get_bucket(hash));
+    }
 
     std::vector<Move> extract_pv(Position &, int);
 
+    // Write the occupied entries to a file, tagged with the network and Zobrist keys they were searched with
+    bool save(std::string const &path) const;
+
+    // Add the entries of a saved table, whatever size it had.
+    // Files written with another network or other Zobrist keys are rejected
+    bool load(std::string const &path);
+
 private:
-    std::vector<TEntry> entries;
+    static constexpr uint8_t GENERATION_MASK = 63;
+
+    // Unpacked second word of a slot
+    struct SlotData {
+        uint16_t move;
+        int16_t score;
+        int16_t seval;
+        uint8_t depth;   // search depth + 1, 0 marks an empty slot
+        uint8_t genflag; // generation << 2 | flag
+
+        uint8_t age(uint8_t current) const {
+            return (current - (genflag >> 2)) & GENERATION_MASK;
+        }
+    };
+
+    static_assert(sizeof(SlotData) == sizeof(uint64_t));
+
+    // Left uninitialized on allocation, reset() clears them
+    struct Slot {
+        std::atomic<uint64_t> key; // hash ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    static constexpr int BUCKET_SIZE = 4;
+
+    struct alignas(64) Bucket {
+        Slot slots[BUCKET_SIZE];
+    };
+
+    static_assert(sizeof(Bucket) == 64 && std::is_trivially_default_constructible_v<Bucket>);
+
+    static uint64_t pack(SlotData const &data) {
+        uint64_t word;
+        memcpy(&word, &data, sizeof(word));
+        return word;
+    }
+
+    static SlotData unpack(uint64_t word) {
+        SlotData data;
+        memcpy(&data, &word, sizeof(word));
+        return data;
+    }
+
+    // Maps the key onto [0, bucket_count) with a multiply instead of a division, any table size works
+    Bucket &get_bucket(uint64_t hash) const {
+        return buckets[static_cast<unsigned __int128>(hash) * bucket_count >> 64];
+    }
+
+    LargeMemory<Bucket> buckets;
+    size_t bucket_count = 0;
+    std::string memory_info;
+    uint8_t generation  = 0;
 };
 
 inline TTable TT(8);
\ No newline at end of file
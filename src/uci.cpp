@@ -26,6 +26,8 @@
 #include "search_threads.h"
 
 #include <cstring>
+#include <iomanip>
+#include <numeric>
 #include <algorithm>
 
 SearchThreadManager THREADS;
@@ -37,9 +39,13 @@ void uci_ok() {
     std::cout << "id network " << std::hex << Network::get_hash() << std::dec << '\n';
     std::cout << "option name Hash type spin default 8 min 2 max 262144" << '\n';
     std::cout << "option name Threads type spin default 1 min 1 max 1024" << '\n';
+    std::cout << "option name SMPMode type combo default Lazy var Lazy var ABDADA" << '\n';
+    std::cout << "option name ThreadBinding type combo default None var None var Spread var Compact" << '\n';
     std::cout << "option name Clear Hash type button" << '\n';
     std::cout << "option name OwnBook type check default false" << '\n';
     std::cout << "option name BookPath type string" << '\n';
+    std::cout << "option name EvalFile type string default <empty>" << '\n';
+    std::cout << "option name HashFile type string default <empty>" << '\n';
     std::cout << "uciok" << std::endl;
 }
 
@@ -47,57 +53,145 @@ void uci_ready() {
     std::cout << "readyok" << std::endl;
 }
 
-void uci_setoption(UciParser const &parser) {
+void uci_loadhash(std::string const &path) {
+    THREADS.stop();
+
+    if (TT.load(path))
+        std::cout << "info string loaded hash file " << path << std::endl;
+    else
+        std::cout << "info string failed to load hash file " << path << std::endl;
+}
+
+void uci_savehash(std::string const &path) {
+    THREADS.stop();
+
+    if (TT.save(path))
+        std::cout << "info string saved hash file " << path << std::endl;
+    else
+        std::cout << "info string failed to save hash file " << path << std::endl;
+}
+
+// HashFile is only loaded on the next isready or go, once the GUI has set Hash and EvalFile in whatever order.
+// Every command that empties or resizes the table marks it to be loaded again
+std::string hash_file;
+bool hash_file_pending = false;
+
+void clear_hash() {
+    THREADS.stop();
+    TT.reset(THREADS.get_thread_count());
+    hash_file_pending = !hash_file.empty();
+}
+
+void load_pending_hash_file() {
+    if (!hash_file_pending)
+        return;
+
+    hash_file_pending = false;
+    uci_loadhash(hash_file);
+}
+
+void uci_setoption(UciParser const &parser, Position &position) {
     auto [name, value] = parser.parse_setoption();
 
     if (name == "hash") {
         if (!string_is_number(value))
             return;
-        TT.resize(std::stoi(value));
+        THREADS.stop();
+        TT.resize(std::stoi(value), THREADS.get_thread_count());
+        std::cout << "info string hash " << TT.get_memory_info() << std::endl;
+        hash_file_pending = !hash_file.empty();
     }
 
     else if (name == "clear hash")
-        TT.reset();
+        clear_hash();
 
     else if (name == "ownbook")
-        PolyGlot::book.enabled = (value == "true");
+        PolyGlot::book.enabled = (tolower(value) == "true");
 
     else if (name == "bookpath")
         PolyGlot::book.open(value);
 
     else if (name == "threads")
         THREADS.set_threads(std::stoull(value));
+
+    else if (name == "smpmode")
+        THREADS.set_smp_mode(tolower(value) == "abdada" ? SMP_ABDADA : SMP_LAZY);
+
+    else if (name == "threadbinding") {
+        tolower(value);
+        THREADS.set_binding(value == "spread" ? BINDING_SPREAD : value == "compact" ? BINDING_COMPACT : BINDING_NONE);
+    }
+
+    else if (name == "hashfile") {
+        hash_file         = value == "<empty>" ? "" : value;
+        hash_file_pending = !hash_file.empty();
+    }
+
+    else if (name == "evalfile") {
+        if (value.empty() || value == "<empty>")
+            return;
+
+        THREADS.stop();
+        if (!Network::load(value)) {
+            std::cout << "info string failed to load network " << value << std::endl;
+            return;
+        }
+
+        position.refresh_network();
+        hash_file_pending = !hash_file.empty();
+        std::cout << "info string loaded network " << std::hex << Network::get_hash() << std::dec << " (" << Network::get_arch() << ")" << std::endl;
+    }
+}
+
+// Counters of the last search, a running search is stopped first
+void uci_stats() {
+    THREADS.stop();
+
+    auto stats   = THREADS.get_stats();
+    auto percent = [](uint64_t part, uint64_t total) { return total ? 100.0 * part / total : 0.0; };
+    auto stores  = std::accumulate(stats.tt_stores.begin(), stats.tt_stores.end(), uint64_t(0));
+
+    std::stringstream o;
+    o << std::fixed << std::setprecision(1);
+    o << "info string tt probes " << stats.tt_probes << " hits " << stats.tt_hits << " (" << percent(stats.tt_hits, stats.tt_probes) << "%)"
+      << " cutoffs " << stats.tt_cutoffs << " (" << percent(stats.tt_cutoffs, stats.tt_probes) << "%)" << '\n';
+    o << "info string tt stores " << stores << " empty " << stats.tt_stores[TTSTORE_EMPTY] << " same " << stats.tt_stores[TTSTORE_UPDATE]
+      << " replaced " << stats.tt_stores[TTSTORE_REPLACE] << " kept " << stats.tt_stores[TTSTORE_KEPT] << '\n';
+    o << "info string tt hashfull " << TT.hashfull() << " size " << TT.get_memory_info() << '\n';
+    o << "info string go latency " << THREADS.get_go_latency().count() << " us";
+    std::cout << o.str() << std::endl;
 }
 
 void uci_go(UciParser const &parser, Position const &position) {
     UciGo options = parser.parse_go();
 
-    SearchInfo search;
-    search.copy_history_tables(THREADS.get_info());
-    search.position = position;
-    search.limits.stopwatch.go();
-    search.limits.max_depth = std::min(options.depth, 64);
+    SearchLimits limits;
+    limits.stopwatch.go();
+    limits.max_depth = std::min(options.depth, 64);
+
+    if (options.nodes != -1)
+        limits.max_nodes = options.nodes;
 
     if (options.movetime == -1) {
-        auto &t   = search.position.get_side() == CLR_WHITE ? options.wtime : options.btime;
-        auto &inc = search.position.get_side() == CLR_WHITE ? options.winc : options.binc;
+        auto &t   = position.get_side() == CLR_WHITE ? options.wtime : options.btime;
+        auto &inc = position.get_side() == CLR_WHITE ? options.winc : options.binc;
 
         if (t == -1)
-            search.limits.movetime = std::numeric_limits<int64_t>::max();
+            limits.movetime = std::numeric_limits<int64_t>::max();
 
         else {
-            search.limits.time_set = true;
-            search.limits.movetime = t / options.movestogo - 50;
+            limits.time_set = true;
+            limits.movetime = t / options.movestogo - 50;
 
             if (options.movestogo != 1) 
-                search.limits.movetime += inc;
+                limits.movetime += inc;
         }
     } else {
-        search.limits.movetime = options.movetime - 50;
-        search.limits.time_set = true;
+        limits.movetime = options.movetime - 50;
+        limits.time_set = true;
     }
 
-    THREADS.begin(search);
+    THREADS.begin(position, limits);
 }
 
 void uci_setposition(UciParser const &parser, Position &position) {
@@ -125,14 +219,32 @@ void init_uci(int argc, char **argv) {
         return;
     }
 
+    if (argc > 1 && !strncmp(argv[1], "evalcheck", 9)) {
+        eval_check();
+        return;
+    }
+
+    if (argc > 1 && !strncmp(argv[1], "ttstress", 8)) {
+        tt_stress();
+        return;
+    }
+
+    if (argc > 1 && !strncmp(argv[1], "quantize", 8)) {
+        if (argc < 4 || !Network::load(argv[2]) || !Network::save_quantized(argv[3]))
+            std::cout << "usage: quantize <network file> <output file>" << std::endl;
+        return;
+    }
+
     while (command.take_input()) {
         if (command == UciCommands::quit) {
             THREADS.stop();
             break;
         }
 
-        else if (command == UciCommands::isready)
+        else if (command == UciCommands::isready) {
+            load_pending_hash_file();
             uci_ready();
+        }
 
         else if (command == UciCommands::uci)
             uci_ok();
@@ -146,23 +258,50 @@ void init_uci(int argc, char **argv) {
         else if (command == UciCommands::perft)
             perft(position, command.parse_perft());
 
-        else if (command == UciCommands::go)
+        else if (command == UciCommands::go) {
+            load_pending_hash_file();
             uci_go(command, position);
+        }
 
         else if (command == UciCommands::stop)
             THREADS.stop();
 
         else if (command == UciCommands::setoption)
-            uci_setoption(command);
+            uci_setoption(command, position);
 
         else if (command == UciCommands::bench) {
-            TT.reset();
+            clear_hash();
             bench();
         }
 
-        else if (command == UciCommands::ucinewgame) {
+        else if (command == UciCommands::savehash)
+            uci_savehash(command.parse_argument());
+
+        else if (command == UciCommands::loadhash)
+            uci_loadhash(command.parse_argument());
+
+        else if (command == UciCommands::stats)
+            uci_stats();
+
+        else if (command == UciCommands::numabench) {
+            auto movetime = command.parse_argument();
+            THREADS.stop();
+            numa_bench(THREADS, string_is_number(movetime) ? std::stoll(movetime) : 1000);
+            hash_file_pending = !hash_file.empty();
+        }
+
+        else if (command == UciCommands::evalcheck)
+            eval_check();
+
+        else if (command == UciCommands::ttstress)
+            tt_stress();
+
+        else if (command == UciCommands::prefetchbench) {
             THREADS.stop();
-            TT.reset();
+            prefetch_bench();
         }
+
+        else if (command == UciCommands::ucinewgame)
+            clear_hash();
     }
 }
@@ -37,6 +37,17 @@ int UciParser::parse_perft() const {
     return std::stoi(options[1]);
 }
 
+std::string UciParser::parse_argument() const {
+    auto space = command.find(' ');
+
+    if (space == std::string::npos)
+        return "";
+
+    auto argument = command.substr(space + 1);
+    trim(argument);
+    return argument;
+}
+
 bool UciParser::operator==(UciCommands type) const {
     switch (type) {
     case UciCommands::uci:
@@ -72,6 +83,27 @@ bool UciParser::operator==(UciCommands type) const {
     case UciCommands::ucinewgame:
         return command == "ucinewgame";
 
+    case UciCommands::savehash:
+        return starts_with(command, "savehash");
+
+    case UciCommands::loadhash:
+        return starts_with(command, "loadhash");
+
+    case UciCommands::stats:
+        return command == "stats";
+
+    case UciCommands::numabench:
+        return starts_with(command, "numabench");
+
+    case UciCommands::evalcheck:
+        return command == "evalcheck";
+
+    case UciCommands::ttstress:
+        return command == "ttstress";
+
+    case UciCommands::prefetchbench:
+        return command == "prefetchbench";
+
     default:
         return false;
         break;
@@ -141,6 +173,9 @@ UciGo UciParser::parse_go() const {
 
         else if (*key == "binc")
             options.binc = std::stoi(value.data());
+
+        else if (*key == "nodes")
+            options.nodes = std::stoll(value.data());
     }
     return options;
 }
@@ -163,8 +198,7 @@ UciParser::parse_setoption() const {
         }
 
         else if (token == "value") {
-            stream >> token;
-            value = std::move(tolower(token));
+            std::getline(stream >> std::ws, value);
             break;
         }
     }
@@ -32,7 +32,14 @@ enum class UciCommands {
     // *debugging/other purpose commands*
     print,
     perft,
-    bench
+    bench,
+    savehash,
+    loadhash,
+    stats,
+    numabench,
+    evalcheck,
+    ttstress,
+    prefetchbench
 };
 
 struct UciGo {
@@ -44,6 +51,7 @@ struct UciGo {
     int64_t movetime = -1;
     int64_t binc     = -1;
     int64_t winc     = -1;
+    int64_t nodes    = -1;
 };
 
 class UciParser {
@@ -57,6 +65,10 @@ public:
     parse_position_command() const;
 
     int parse_perft() const;
+
+    // Everything after the command name, as the path of savehash/loadhash
+    std::string parse_argument() const;
+
     UciGo parse_go() const;
     std::pair<std::string, std::string>
     parse_setoption() const;
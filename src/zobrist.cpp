@@ -61,6 +61,24 @@ ZobristKey generate_zobrist_hash(Position const &position) {
     return hash;
 }
 
+ZobristKey zobrist_keys_checksum() {
+    ZobristKey checksum = CLR_KEY;
+
+    auto mix = [&](ZobristKey key) { checksum = (checksum << 1 | checksum >> 63) ^ key; };
+
+    for (auto key : EP_KEYS)
+        mix(key);
+
+    for (auto key : CASTLE_KEYS)
+        mix(key);
+
+    for (auto const &keys : PCE_KEYS) {
+        for (auto key : keys)
+            mix(key);
+    }
+    return checksum;
+}
+
 void zobrist_hash_piece(ZobristKey &hash, const Piece pce, const Square sq) {
     hash ^= PCE_KEYS[pce][sq];
 }
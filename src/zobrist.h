@@ -29,4 +29,7 @@ void zobrist_hash_ep(ZobristKey &, Square);
 
 void zobrist_hash_castle(ZobristKey &, uint64_t castle_bits);
 
-void init_zobrist_keys();
\ No newline at end of file
+void init_zobrist_keys();
+
+// Fingerprint of every key, data hashed with other keys can be told apart
+ZobristKey zobrist_keys_checksum();
\ No newline at end of file